@@ -28,6 +28,7 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include "utility.h"
+#include "benchmark.h"
 
 using namespace cv;
 using namespace dip;
@@ -90,6 +91,9 @@ Mat shearV(Mat input, double shearVal);
  **/
 Mat shearH(Mat input, double shearVal);
 
+//Measures the transformations on synthetic images against cv::resize and cv::warpAffine, see dip::Benchmark
+int benchmark(int largestSize);
+
 int main(int argc, char** argv) {
             const String keys = 
     "{help h usage ?    |                           | The program does affine transformations such as scale, rotation, translation, vertical and horizontal shearing.}"
@@ -99,6 +103,8 @@ int main(int argc, char** argv) {
     "{translation       | 60,60                     | shift P(x,y)}"
     "{shearV            | 0.3                       | vertical shear value}"
     "{shearH            | 0.4                       | horizontal shear value}"
+    "{bench             |                           | measure the transformations on synthetic images instead of showing them}"
+    "{benchLargest      | 16384                     | size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -110,6 +116,9 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    if (cmdParser.has("bench"))
+        return benchmark(cmdParser.get<int>("benchLargest"));
+
     input = imread(cmdParser.get<cv::String>("input").c_str());
 
     if ( !input.data )
@@ -275,4 +284,43 @@ Mat shearH(Mat input, double sh)
 	}
 
 	return output;
-}
\ No newline at end of file
+}
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("affine-transformation", largestSize);
+
+	//The nearest pixel is taken by both, as in the transformations
+	auto warped = [](const Mat& f, const Mat& t, Size size) {
+		Mat g;
+		warpAffine(f, g, t, size, INTER_NEAREST);
+		return g;
+	};
+
+	benchmark.run("scale", [](const Mat& f) { return scale(f, 0.7, 1.7); }, [](const Mat& f) {
+		Mat g;
+		resize(f, g, Size(), 1.7, 0.7, INTER_NEAREST);
+		return g;
+	});
+	//The output of the rotation is twice as large in both directions
+	benchmark.run("rotate", [](const Mat& f) { return rotate(f, (180 + 45) / 180.0 * CV_PI); }, [&](const Mat& f) {
+		Mat t = getRotationMatrix2D(Point2f(f.cols / 2.0f, f.rows / 2.0f), 45, 1);
+		t.at<double>(0, 2) += f.cols / 2.0;
+		t.at<double>(1, 2) += f.rows / 2.0;
+		return warped(f, t, Size(f.cols * 2, f.rows * 2));
+	}, 4096);
+	benchmark.run("translate", [](const Mat& f) { return translate(f, Size(60, 60)); }, [&](const Mat& f) {
+		Mat t = (Mat_<double>(2, 3) << 1, 0, 60, 0, 1, 60);
+		return warped(f, t, f.size());
+	});
+	benchmark.run("vertical shear", [](const Mat& f) { return shearV(f, 0.3); }, [&](const Mat& f) {
+		Mat t = (Mat_<double>(2, 3) << 1, 0.3, 0, 0, 1, 0);
+		return warped(f, t, Size(f.cols + static_cast<int>(0.3 * f.cols), f.rows));
+	});
+	benchmark.run("horizontal shear", [](const Mat& f) { return shearH(f, 0.4); }, [&](const Mat& f) {
+		Mat t = (Mat_<double>(2, 3) << 1, 0, 0, 0.4, 1, 0);
+		return warped(f, t, Size(f.cols, f.rows + static_cast<int>(std::round(0.4 * f.rows)) + 3));
+	});
+
+	return 0;
+}
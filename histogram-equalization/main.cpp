@@ -26,41 +26,99 @@
  */
 
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <vector>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "utility.h"
+#include "histogram.h"
+#include "benchmark.h"
 
+//Intensity levels of the adaptive equalization, which works on 8-bit images
 #define L 256
 
 using namespace cv;
 
-//Fills the array with zeros
-void fillZero(double* arr, int size);
-
 /* Chapter 3.3 is implemented. It performs 3.3-8. equation on the image.
 * It is also useful to look at 
 * https://www.tutorialspoint.com/dip/introduction_to_probability.htm and https://www.tutorialspoint.com/dip/histogram_equalization.htm
 * pages for simpler explanation.
+* Bins is 256 for CV_8U and 65536 for CV_16U images, the mapping is applied through a lookup table of Bins entries.
 */
+template <int Bins>
 Mat equalizeHistogram(Mat input);
 
-void fillZero(double* arr, int size);
+/* Contrast limited adaptive histogram equalization.
+* The image is split into tileSize x tileSize tiles, every tile gets its own clipped histogram and mapping,
+* then every pixel is mapped by bilinearly blending the mappings of the four nearest tile centers.
+* clipLimit is relative to the average bin height of a tile, the clipped counts are spread over all bins.
+*/
+Mat equalizeHistogramAdaptive(Mat input, int tileSize, double clipLimit);
+
+//Clips the bins at the limit and redistributes the excess uniformly
+void clipHistogram(int* histogram, int limit);
+
+/* Local histogram equalization which is mentioned at Chapter 3.3.3, every pixel is mapped by Eq. 3.3-8 on the histogram of the windowSize x windowSize neighbourhood around it.
+* The window slides along each row, the incoming column is added and the outgoing column is subtracted(Huang's algorithm),
+* so a pixel costs O(windowSize) instead of O(windowSize^2). A second histogram of 16 coarse bins keeps the CDF lookup of the center constant.
+* Windows are clipped at the image borders and rows are processed in parallel bands.
+*/
+Mat equalizeHistogramLocal(Mat input, int windowSize);
+
+//Shows the histograms of the input and the output
+template <int Bins>
+void showHistograms(Mat input, Mat output);
+
+/* Equalizes a stream of frames.
+* All buffers are allocated once, so a frame costs one histogram pass and one mapping pass.
+* The CDF is smoothed over time with an exponential moving average to stop flicker,
+* and the mapping is rebuilt only when the smoothed CDF drifts more than the threshold(largest CDF difference)
+* from the CDF the current mapping was built with.
+*/
+template <int Bins>
+class StreamingEqualizer
+{
+public:
+	StreamingEqualizer(double smoothing, double driftThreshold);
+
+	void equalize(const Mat& frame, Mat& output);
+
+	int rebuildCount() const { return rebuilds; }
+
+private:
+	typedef typename dip::HistogramTraits<Bins>::Pixel Pixel;
 
-double* calculateHistogram(Mat input);
+	double smoothing;
+	double driftThreshold;
+	bool initialized;
+	int rebuilds;
+	std::vector<uint32_t> histogram;
+	std::vector<double> smoothedCdf;
+	std::vector<double> mappedCdf;
+	std::vector<Pixel> mapping;
+};
 
-//pdf array  represents the pr(rj) part of Eq. 3.3-8
-double* calculatePdf(double* histogram, int totalPixelSize);
+//Equalizes the frames of a video file or a camera, the source is a camera index when it is a number
+int equalizeStream(const std::string& source, double smoothing, double driftThreshold);
 
-//                          k
-//Cdf function reprents the E pr(rj) part of Eq. 3.3-8
-//                          j=0
-double* calculateCdf(double* pdf);
+//Measures the equalizations of 8-bit synthetic images against cv::equalizeHist and cv::CLAHE, see dip::Benchmark
+int benchmark(int largestSize);
 
 int main(int argc, char** argv) {
         const String keys = 
 	"{help h usage ?    || The program does histogram equalization on the image.}"
     "{input             | histogram-equalization.png | input image}"
+	"{method            | global                     | equalization method, global, adaptive or local}"
+	"{tileSize          | 64                         | tile size of the adaptive equalization}"
+	"{clipLimit         | 2.0                        | clip limit of the adaptive equalization, relative to the average bin height of a tile}"
+	"{windowSize        | 15                         | window size of the local equalization, 15 means 15x15}"
+	"{video             |                            | video file or camera index, its frames are equalized as a stream}"
+	"{smoothing         | 0.1                        | weight of the newest frame in the moving average of the stream CDF}"
+	"{drift             | 0.01                       | CDF difference which rebuilds the mapping of the stream}"
+	"{bench             |                            | measure the equalizations on synthetic images instead of showing them}"
+	"{benchLargest      | 16384                      | size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -71,9 +129,16 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
+	if (cmdParser.has("video"))
+		return equalizeStream(cmdParser.get<cv::String>("video"), cmdParser.get<double>("smoothing"), cmdParser.get<double>("drift"));
+
 	Mat input;
 
-    input = imread(cmdParser.get<cv::String>("input").c_str());
+	//16-bit images are kept as they are, reducing them to 8 bits loses their dynamic range
+    input = imread(cmdParser.get<cv::String>("input").c_str(), IMREAD_ANYDEPTH | IMREAD_ANYCOLOR);
 
     if ( !input.data )
     {
@@ -81,100 +146,439 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    cvtColor(input , input , COLOR_BGR2GRAY);
+	if (input.depth() != CV_8U && input.depth() != CV_16U)
+	{
+		std::cout << "Only 8-bit and 16-bit images are supported." << std::endl;
+		return -1;
+	}
 
-	//Performs histogram equalization
-	auto histogramEqualizedImage = equalizeHistogram(input);
+	if (input.channels() == 3)
+		cvtColor(input , input , COLOR_BGR2GRAY);
+
+	auto method = cmdParser.get<cv::String>("method");
 
     imshow("input" , input);
-	imshow("Histogram equalized output", histogramEqualizedImage);
+
+	if (method == "adaptive")
+	{
+		auto tileSize = cmdParser.get<int>("tileSize");
+		auto clipLimit = cmdParser.get<double>("clipLimit");
+
+		if (input.depth() != CV_8U)
+		{
+			std::cout << "Adaptive equalization supports 8-bit images only." << std::endl;
+			return 1;
+		}
+
+		if (tileSize <= 0)
+		{
+			std::cout << "tileSize must be positive." << std::endl;
+			return 1;
+		}
+
+		imshow("Adaptive histogram equalized output", equalizeHistogramAdaptive(input, tileSize, clipLimit));
+	}
+	else if (method == "local")
+	{
+		auto windowSize = cmdParser.get<int>("windowSize");
+
+		if (input.depth() != CV_8U)
+		{
+			std::cout << "Local equalization supports 8-bit images only." << std::endl;
+			return 1;
+		}
+
+		if (windowSize <= 0 || windowSize % 2 == 0)
+		{
+			std::cout << "windowSize must be positive and odd." << std::endl;
+			return 1;
+		}
+
+		imshow("Local histogram equalized output", equalizeHistogramLocal(input, windowSize));
+	}
+	else
+	{
+		//Performs histogram equalization
+		auto histogramEqualizedImage = input.depth() == CV_16U ? equalizeHistogram<65536>(input) : equalizeHistogram<256>(input);
+
+		if (input.depth() == CV_16U)
+			showHistograms<65536>(input, histogramEqualizedImage);
+		else
+			showHistograms<256>(input, histogramEqualizedImage);
+
+		imshow("Histogram equalized output", histogramEqualizedImage);
+	}
 
     waitKey(0);
 
     return 0;
 }
 
-void fillZero(double* arr, int size)
+template <int Bins>
+Mat equalizeHistogram(Mat input)
 {
-	for (auto i = 0; i < size; ++i)
-	{
-		arr[i] = 0;
-	}
+	Mat output;
+
+	//Firstly calculate histogram
+	auto inputHistogram = dip::calculateHistogram<Bins>(input);
+	//Secondly extract probability density function(PDF) from the histogram
+	auto inputPdf = dip::calculatePdf<Bins>(inputHistogram, input.rows * input.cols);
+	//Thirdly cumulative probability function(CDF) from PDF
+	auto inputCdf = dip::calculateCdf<Bins>(inputPdf);
+
+	//As last, map old image intensity values
+	dip::applyMapping(input, dip::equalizationMapping<Bins>(inputCdf), output);
+
+	return output;
+}
+
+template <int Bins>
+void showHistograms(Mat input, Mat output)
+{
+	auto inputPdf = dip::calculatePdf<Bins>(dip::calculateHistogram<Bins>(input), input.rows * input.cols);
+	auto outputPdf = dip::calculatePdf<Bins>(dip::calculateHistogram<Bins>(output), output.rows * output.cols);
+
+	imshow("input histogram", dip::drawHistogram(inputPdf));
+	imshow("output histogram", dip::drawHistogram(outputPdf));
 }
 
-double* calculateHistogram(Mat input)
+template <int Bins>
+StreamingEqualizer<Bins>::StreamingEqualizer(double smoothing, double driftThreshold)
+	: smoothing(smoothing)
+	, driftThreshold(driftThreshold)
+	, initialized(false)
+	, rebuilds(0)
+	, histogram(Bins)
+	, smoothedCdf(Bins)
+	, mappedCdf(Bins)
+	, mapping(Bins)
 {
-	double* inputHistogram = new double[L];
-	fillZero(inputHistogram, L);
+}
+
+template <int Bins>
+void StreamingEqualizer<Bins>::equalize(const Mat& frame, Mat& output)
+{
+	std::fill(histogram.begin(), histogram.end(), 0);
+	dip::calculateHistogram<Bins>(frame, histogram.data());
+
+	double totalPixelSize = frame.rows * frame.cols;
+	auto cumulative = 0u;
+	auto drift = .0;
+
+	//Moving average of the CDF and its largest difference from the mapped one
+	for (auto i = 0; i < Bins; ++i)
+	{
+		cumulative += histogram[i];
+
+		auto cdf = cumulative / totalPixelSize;
 
-	for (auto y = 0; y < input.rows; ++y)
+		smoothedCdf[i] = initialized ? smoothing * cdf + (1 - smoothing) * smoothedCdf[i] : cdf;
+		drift = std::max(drift, std::abs(smoothedCdf[i] - mappedCdf[i]));
+	}
+
+	if (!initialized || drift > driftThreshold)
 	{
-		for (auto x = 0; x < input.cols; ++x)
+		for (auto i = 0; i < Bins; ++i)
 		{
-			inputHistogram[input.at<uchar>(y, x)]++;
+			mappedCdf[i] = smoothedCdf[i];
+			mapping[i] = static_cast<Pixel>(std::round((Bins - 1) * mappedCdf[i]));
 		}
+
+		initialized = true;
+		rebuilds++;
 	}
 
-	return inputHistogram;
+	dip::applyMapping(frame, mapping, output);
 }
 
-double* calculatePdf(double* histogram, int totalPixelSize)
+int equalizeStream(const std::string& source, double smoothing, double driftThreshold)
 {
-	double* pdf = new double[L];
-	fillZero(pdf, L);
+	VideoCapture capture;
 
-	for (auto i = 0; i < L; ++i)
+	if (!source.empty() && std::all_of(source.begin(), source.end(), ::isdigit))
+		capture.open(std::stoi(source));
+	else
+		capture.open(source);
+
+	if (!capture.isOpened())
+	{
+		std::cout << "Video source " << source << " could not be opened" << std::endl;
+		return -1;
+	}
+
+	StreamingEqualizer<256> equalizer(smoothing, driftThreshold);
+	Mat frame, gray, output;
+	auto frames = 0;
+	auto start = getTickCount();
+
+	while (capture.read(frame))
 	{
-		pdf[i] = histogram[i] / totalPixelSize;
+		if (frame.channels() == 3)
+			cvtColor(frame, gray, COLOR_BGR2GRAY);
+		else
+			gray = frame;
+
+		equalizer.equalize(gray, output);
+		frames++;
+
+		imshow("input", gray);
+		imshow("Histogram equalized stream", output);
+
+		auto key = waitKey(1);
+
+		if (key == 27 || key == 'q')
+			break;
 	}
 
-	return pdf;
+	auto elapsed = (getTickCount() - start) / getTickFrequency();
+
+	std::cout << frames << " frames are equalized in " << elapsed << " s, the mapping is rebuilt " << equalizer.rebuildCount() << " times" << std::endl;
+
+	return 0;
 }
 
-double* calculateCdf(double* pdf)
+void clipHistogram(int* histogram, int limit)
 {
-	double* cdf = new double[L];
-	fillZero(cdf, L);
-	cdf[0] = pdf[0];
+	auto excess = 0;
 
-	for (auto i = 1; i < L; ++i)
+	for (auto i = 0; i < L; ++i)
 	{
-		cdf[i] = cdf[i - 1] + pdf[i];
+		if (histogram[i] > limit)
+		{
+			excess += histogram[i] - limit;
+			histogram[i] = limit;
+		}
+	}
+
+	auto increment = excess / L;
+	auto residual = excess % L;
+
+	for (auto i = 0; i < L; ++i)
+	{
+		histogram[i] += increment;
 	}
 
-	return cdf;
+	//Spread the remainder evenly over the whole range
+	if (residual > 0)
+	{
+		auto step = L / residual;
+
+		for (auto i = 0; i < L && residual > 0; i += step, --residual)
+		{
+			histogram[i]++;
+		}
+	}
 }
 
-Mat equalizeHistogram(Mat input)
+Mat equalizeHistogramAdaptive(Mat input, int tileSize, double clipLimit)
 {
+	Mat output(input.rows, input.cols, CV_8U);
 
-	//Firstly calculate histogram
-	double* inputHistogram = calculateHistogram(input);
-	//Secondly extract probability density function(PDF) from the histogram
-	double* inputPdf = calculatePdf(inputHistogram, input.rows * input.cols);
-	//Thirdly cumulative probability function(CDF) from PDF
-	double* inputCdf = calculateCdf(inputPdf);
+	auto tilesX = (input.cols + tileSize - 1) / tileSize;
+	auto tilesY = (input.rows + tileSize - 1) / tileSize;
 
-	Mat output(input.rows, input.cols, CV_8U);
+	//Mappings of all tiles, tile (tx, ty) starts at (ty * tilesX + tx) * L
+	std::vector<uchar> mappings(tilesX * tilesY * L);
 
-	//As last, map old image intensity values
-	for (auto y = 0; y < input.rows; ++y)
-	{
-		for (auto x = 0; x < input.cols; ++x)
+	//Every tile is independent, so histograms and mappings are calculated in parallel
+	parallel_for_(Range(0, tilesX * tilesY), [&](const Range& range) {
+		for (auto tile = range.start; tile < range.end; ++tile)
+		{
+			auto tileRect = Rect((tile % tilesX) * tileSize, (tile / tilesX) * tileSize, tileSize, tileSize) & Rect(0, 0, input.cols, input.rows);
+			auto totalPixelSize = tileRect.area();
+			int histogram[L] = {};
+
+			for (auto y = tileRect.y; y < tileRect.y + tileRect.height; ++y)
+			{
+				auto row = input.ptr<uchar>(y);
+
+				for (auto x = tileRect.x; x < tileRect.x + tileRect.width; ++x)
+				{
+					histogram[row[x]]++;
+				}
+			}
+
+			if (clipLimit > 0)
+			{
+				auto limit = std::max(1, static_cast<int>(clipLimit * totalPixelSize / L));
+				clipHistogram(histogram, limit);
+			}
+
+			auto mapping = &mappings[tile * L];
+			auto cumulative = 0;
+
+			//Eq. 3.3-8 on the tile
+			for (auto i = 0; i < L; ++i)
+			{
+				cumulative += histogram[i];
+				mapping[i] = static_cast<uchar>(std::round((L - 1) * static_cast<double>(cumulative) / totalPixelSize));
+			}
+		}
+	});
+
+	//For every column and row, find the tiles whose centers surround it and the weight of the second one
+	//Pixels outside of the outermost centers use the outermost mapping only
+	auto neighbourTiles = [tileSize](int length, int tiles, std::vector<int>& first, std::vector<float>& weight) {
+		first.resize(length);
+		weight.resize(length);
+
+		auto center = [&](int tile) {
+			auto end = std::min(length, (tile + 1) * tileSize);
+			return (tile * tileSize + end - 1) / 2.0;
+		};
+
+		auto tile = 0;
+
+		for (auto i = 0; i < length; ++i)
 		{
-			auto oldIntensity = input.at<uchar>(y, x);
+			while (tile < tiles - 2 && center(tile + 1) <= i)
+				++tile;
+
+			if (tiles == 1)
+			{
+				first[i] = 0;
+				weight[i] = 0;
+				continue;
+			}
 
-			//Full implementation of Equation 3.3-8
-			output.at<uchar>(y, x) = std::round((L - 1) * inputCdf[oldIntensity]);
+			auto begin = center(tile);
+			auto end = center(tile + 1);
+
+			first[i] = tile;
+			weight[i] = static_cast<float>(dip::stayInBoundaries((i - begin) / (end - begin), dip::Upper(1.0), dip::Lower(0.0)));
 		}
-	}
+	};
 
-	//Calculate output histogram and pdf
-	double* outputHistogram = calculateHistogram(output);
-	double* outputPdf = calculatePdf(outputHistogram, output.rows * output.cols);
+	std::vector<int> tileX, tileY;
+	std::vector<float> weightX, weightY;
 
-	imshow("input histogram", dip::drawHistogram(inputPdf, L));
-	imshow("output histogram", dip::drawHistogram(outputPdf, L));
+	neighbourTiles(input.cols, tilesX, tileX, weightX);
+	neighbourTiles(input.rows, tilesY, tileY, weightY);
+
+	//Single mapping pass, blends the four nearest tile mappings
+	parallel_for_(Range(0, input.rows), [&](const Range& range) {
+		for (auto y = range.start; y < range.end; ++y)
+		{
+			auto inputRow = input.ptr<uchar>(y);
+			auto outputRow = output.ptr<uchar>(y);
+			auto ty0 = tileY[y];
+			auto ty1 = std::min(ty0 + 1, tilesY - 1);
+			auto wy = weightY[y];
+
+			for (auto x = 0; x < input.cols; ++x)
+			{
+				auto tx0 = tileX[x];
+				auto tx1 = std::min(tx0 + 1, tilesX - 1);
+				auto wx = weightX[x];
+				auto intensity = inputRow[x];
+
+				auto top = (1 - wx) * mappings[(ty0 * tilesX + tx0) * L + intensity] + wx * mappings[(ty0 * tilesX + tx1) * L + intensity];
+				auto bottom = (1 - wx) * mappings[(ty1 * tilesX + tx0) * L + intensity] + wx * mappings[(ty1 * tilesX + tx1) * L + intensity];
+
+				outputRow[x] = static_cast<uchar>((1 - wy) * top + wy * bottom + 0.5f);
+			}
+		}
+	});
 
 	return output;
-}
\ No newline at end of file
+}
+
+Mat equalizeHistogramLocal(Mat input, int windowSize)
+{
+	Mat output(input.rows, input.cols, CV_8U);
+	auto half = windowSize / 2;
+
+	parallel_for_(Range(0, input.rows), [&](const Range& range) {
+		int histogram[L];
+		int coarse[L / 16];
+		std::vector<const uchar*> rows(windowSize);
+
+		for (auto y = range.start; y < range.end; ++y)
+		{
+			auto firstRow = std::max(0, y - half);
+			auto lastRow = std::min(input.rows - 1, y + half);
+			auto height = lastRow - firstRow + 1;
+
+			for (auto r = 0; r < height; ++r)
+			{
+				rows[r] = input.ptr<uchar>(firstRow + r);
+			}
+
+			std::fill(histogram, histogram + L, 0);
+			std::fill(coarse, coarse + L / 16, 0);
+
+			auto addColumn = [&](int x, int amount) {
+				for (auto r = 0; r < height; ++r)
+				{
+					auto intensity = rows[r][x];
+					histogram[intensity] += amount;
+					coarse[intensity >> 4] += amount;
+				}
+			};
+
+			//Window of the first pixel
+			for (auto x = 0; x < std::min(input.cols, half + 1); ++x)
+			{
+				addColumn(x, 1);
+			}
+
+			auto inputRow = input.ptr<uchar>(y);
+			auto outputRow = output.ptr<uchar>(y);
+
+			for (auto x = 0; x < input.cols; ++x)
+			{
+				if (x > 0)
+				{
+					if (x - half - 1 >= 0)
+						addColumn(x - half - 1, -1);
+					if (x + half < input.cols)
+						addColumn(x + half, 1);
+				}
+
+				auto width = std::min(input.cols - 1, x + half) - std::max(0, x - half) + 1;
+				auto intensity = inputRow[x];
+
+				//Number of the pixels which are not brighter than the center, coarse bins below it and fine bins of its own coarse bin
+				auto cumulative = 0;
+
+				for (auto i = 0; i < (intensity >> 4); ++i)
+				{
+					cumulative += coarse[i];
+				}
+
+				for (auto i = intensity & ~15; i <= intensity; ++i)
+				{
+					cumulative += histogram[i];
+				}
+
+				outputRow[x] = static_cast<uchar>(std::round((L - 1) * static_cast<double>(cumulative) / (width * height)));
+			}
+		}
+	});
+
+	return output;
+}
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("histogram-equalization", largestSize);
+
+	const auto tileSize = 64;
+	const auto clipLimit = 2.0;
+
+	benchmark.run("global", [](const Mat& f) { return equalizeHistogram<256>(f); }, [](const Mat& f) {
+		Mat g;
+		equalizeHist(f, g);
+		return g;
+	});
+	//The tiles of CLAHE are given by their number, the clip limits of both are relative to the average bin height
+	benchmark.run("adaptive", [&](const Mat& f) { return equalizeHistogramAdaptive(f, tileSize, clipLimit); }, [&](const Mat& f) {
+		auto clahe = createCLAHE(clipLimit, Size(std::max(1, f.cols / tileSize), std::max(1, f.rows / tileSize)));
+		Mat g;
+		clahe->apply(f, g);
+		return g;
+	});
+	benchmark.run("local 15x15", [](const Mat& f) { return equalizeHistogramLocal(f, 15); });
+
+	return 0;
+}
@@ -26,40 +26,83 @@
  */
 
 #include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "utility.h"
-
-#define L 256
+#include "histogram.h"
+#include "benchmark.h"
 
 using namespace cv;
 
-//Fills the array with zeros
-void fillZero(double* arr, int size);
+//Template side of the histogram specification function, it depends only on the template image
+template <int Bins>
+struct TemplateCdf
+{
+	//(Bins - 1) * G(zq) values of the template
+	std::vector<double> levels;
+	//First intensity of the run which shares the same G(zq), ties are resolved to the lowest intensity
+	std::vector<int> runStart;
+	std::vector<double> pdf;
+	//The template the CDF was built from, a hit of the hash is compared with it
+	Mat source;
+};
+
+//Template CDFs keyed by the content hash of the template and checked against a copy of it, so matching many inputs against the same template does the template work once
+template <int Bins>
+class TemplateCdfCache
+{
+public:
+	const TemplateCdf<Bins>& get(Mat templateImg);
+
+private:
+	std::unordered_map<uint64_t, TemplateCdf<Bins>> cache;
+};
+
+//FNV-1a hash of the image dimensions, type and pixels
+uint64_t contentHash(Mat input);
+
+//Whether both images have the same dimensions, type and pixels
+bool sameContent(Mat a, Mat b);
 
 /* Chapter 3.3.2 is implemented.
 * It is also useful to look at 
 * https://stackoverflow.com/a/33047048
 * pages for simpler explanation.
+* Both CDFs are monotone, so the mapping is built with a single two-pointer pass instead of searching all template intensities for every input intensity.
+* Bins is 256 for CV_8U and 65536 for CV_16U images.
 */
-Mat histogramMatching(Mat input, Mat templateImg);
+template <int Bins>
+Mat histogramMatching(Mat input, const TemplateCdf<Bins>& templateCdf);
+template <int Bins>
+Mat histogramMatching(Mat input, Mat templateImg, TemplateCdfCache<Bins>& cache);
 
-double* calculateHistogram(Mat input);
+//Batch mode, the template is processed once and every input costs one histogram and one mapping pass
+template <int Bins>
+std::vector<Mat> histogramMatching(const std::vector<Mat>& inputs, Mat templateImg, TemplateCdfCache<Bins>& cache);
 
-//pdf array  represents the pr(rj) part of Eq. 3.3-8
-double* calculatePdf(double* histogram, int totalPixelSize);
+//Reads the inputs, matches them against the template and shows or writes the outputs
+template <int Bins>
+int matchImages(const CommandLineParser& cmdParser, Mat templateImg);
 
-//                          k
-//Cdf function reprents the E pr(rj) part of Eq. 3.3-8
-//                          j=0
-double* calculateCdf(double* pdf);
+//Reads an 8-bit or 16-bit image as grayscale without reducing its depth
+Mat readGrayscale(const std::string& path);
+
+//Measures the matching of 8-bit synthetic images, see dip::Benchmark
+int benchmark(int largestSize);
 
 int main(int argc, char** argv) {
         const String keys = 
 	"{help h usage ?    || The program does histogram matching.}"
     "{input             | histogram-matching-input.jpg | input image}"
 	"{template          | histogram-matching-template.jpg | template image}"
+	"{batch             |                                 | comma separated input images, all of them are matched against the template}"
+	"{output            | histogram-matched-              | prefix of the images written in batch mode}"
+	"{bench             |                                 | measure the matching on synthetic images instead of showing it}"
+	"{benchLargest      | 16384                           | size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -70,10 +113,79 @@ int main(int argc, char** argv) {
         return 0;
     }
 
-	Mat input , templateImg;
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
+	Mat templateImg = readGrayscale(cmdParser.get<cv::String>("template"));
+
+	if (!templateImg.data)
+	{
+		std::cout << "No template data" << std::endl;
+		return -1;
+	}
+
+	if (templateImg.depth() == CV_16U)
+		return matchImages<65536>(cmdParser, templateImg);
+
+	if (templateImg.depth() == CV_8U)
+		return matchImages<256>(cmdParser, templateImg);
+
+	std::cout << "Only 8-bit and 16-bit images are supported." << std::endl;
+
+    return -1;
+}
+
+Mat readGrayscale(const std::string& path)
+{
+	Mat image = imread(path, IMREAD_ANYDEPTH | IMREAD_ANYCOLOR);
+
+	if (image.data && image.channels() == 3)
+		cvtColor(image, image, COLOR_BGR2GRAY);
 
-    input = imread(cmdParser.get<cv::String>("input").c_str());
-	templateImg = imread(cmdParser.get<cv::String>("template").c_str());
+	return image;
+}
+
+template <int Bins>
+int matchImages(const CommandLineParser& cmdParser, Mat templateImg)
+{
+	TemplateCdfCache<Bins> cache;
+	auto depth = static_cast<int>(dip::HistogramTraits<Bins>::Depth);
+
+	if (cmdParser.has("batch"))
+	{
+		std::vector<std::string> paths;
+		dip::split(cmdParser.get<cv::String>("batch"), paths, ',');
+
+		std::vector<Mat> inputs;
+
+		for (const auto& path : paths)
+		{
+			Mat batchInput = readGrayscale(path);
+
+			if (!batchInput.data || batchInput.depth() != depth)
+			{
+				std::cout << "No input data at " << path << " or its depth differs from the template" << std::endl;
+				return -1;
+			}
+
+			inputs.push_back(batchInput);
+		}
+
+		auto start = getTickCount();
+		auto outputs = histogramMatching(inputs, templateImg, cache);
+		auto elapsed = (getTickCount() - start) / getTickFrequency();
+
+		std::cout << outputs.size() << " images are matched in " << elapsed * 1000 << " ms" << std::endl;
+
+		for (auto i = 0u; i < outputs.size(); ++i)
+		{
+			imwrite(cmdParser.get<cv::String>("output") + std::to_string(i) + ".png", outputs[i]);
+		}
+
+		return 0;
+	}
+
+	Mat input = readGrayscale(cmdParser.get<cv::String>("input"));
 
     if ( !input.data )
     {
@@ -81,16 +193,20 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-	if (!templateImg.data)
+	if (input.depth() != depth)
 	{
-		std::cout << "No template data" << std::endl;
+		std::cout << "Input and template depths differ" << std::endl;
 		return -1;
 	}
 
-    cvtColor(input , input , COLOR_BGR2GRAY);
-	cvtColor(templateImg, templateImg, COLOR_BGR2GRAY);
+	auto histogramMatchedImg = histogramMatching(input , templateImg, cache);
+
+	auto inputPdf = dip::calculatePdf<Bins>(dip::calculateHistogram<Bins>(input), input.rows * input.cols);
+	auto outputPdf = dip::calculatePdf<Bins>(dip::calculateHistogram<Bins>(histogramMatchedImg), histogramMatchedImg.rows * histogramMatchedImg.cols);
 
-	auto histogramMatchedImg = histogramMatching(input , templateImg);
+	imshow("Input Histogram", dip::drawHistogram(inputPdf));
+	imshow("Template Histogram", dip::drawHistogram(cache.get(templateImg).pdf));
+	imshow("Output Histogram", dip::drawHistogram(outputPdf));
 
     imshow("input" , input);
 	imshow("template img", templateImg);
@@ -101,112 +217,157 @@ int main(int argc, char** argv) {
     return 0;
 }
 
-void fillZero(double* arr, int size)
+uint64_t contentHash(Mat input)
 {
-	for (auto i = 0; i < size; ++i)
-	{
-		arr[i] = 0;
-	}
-}
+	auto hash = 14695981039346656037ULL;
+	auto mix = [&hash](uint64_t value) {
+		hash ^= value;
+		hash *= 1099511628211ULL;
+	};
 
-double* calculateHistogram(Mat input)
-{
-	double* inputHistogram = new double[L];
-	fillZero(inputHistogram, L);
+	mix(input.rows);
+	mix(input.cols);
+	mix(input.type());
+
+	auto rowSize = input.cols * input.elemSize();
 
 	for (auto y = 0; y < input.rows; ++y)
 	{
-		for (auto x = 0; x < input.cols; ++x)
+		auto row = input.ptr<uchar>(y);
+
+		for (auto x = 0u; x < rowSize; ++x)
 		{
-			inputHistogram[input.at<uchar>(y, x)]++;
+			mix(row[x]);
 		}
 	}
 
-	return inputHistogram;
+	return hash;
 }
 
-double* calculatePdf(double* histogram , int totalPixelSize)
+bool sameContent(Mat a, Mat b)
 {
-	double* pdf = new double[L];
-	fillZero(pdf, L);
+	if (a.size() != b.size() || a.type() != b.type())
+		return false;
+
+	auto rowSize = a.cols * a.elemSize();
 
-	for (auto i = 0; i < L; ++i)
+	for (auto y = 0; y < a.rows; ++y)
 	{
-		pdf[i] = histogram[i] / totalPixelSize;
+		if (std::memcmp(a.ptr<uchar>(y), b.ptr<uchar>(y), rowSize) != 0)
+			return false;
 	}
 
-	return pdf;
+	return true;
 }
 
-double* calculateCdf(double* pdf)
+template <int Bins>
+const TemplateCdf<Bins>& TemplateCdfCache<Bins>::get(Mat templateImg)
 {
-	double* cdf = new double[L];
-	fillZero(cdf, L);
-	cdf[0] = pdf[0];
+	auto key = contentHash(templateImg);
+	auto cached = cache.find(key);
+
+	//Different templates of the same hash replace each other
+	if (cached != cache.end() && sameContent(cached->second.source, templateImg))
+		return cached->second;
+
+	auto& entry = cache[key];
+	entry.source = templateImg.clone();
 
-	for (auto i = 1; i < L; ++i)
+	auto templateHistogram = dip::calculateHistogram<Bins>(templateImg);
+	auto templatePdf = dip::calculatePdf<Bins>(templateHistogram, templateImg.rows * templateImg.cols);
+	auto templateCdf = dip::calculateCdf<Bins>(templatePdf);
+
+	entry.levels.resize(Bins);
+	entry.runStart.resize(Bins);
+
+	for (auto j = 0; j < Bins; ++j)
 	{
-		cdf[i] = cdf[i - 1] + pdf[i];
+		entry.levels[j] = (Bins - 1) * templateCdf[j];
+		entry.runStart[j] = (j > 0 && entry.levels[j] == entry.levels[j - 1]) ? entry.runStart[j - 1] : j;
 	}
 
-	return cdf;
+	entry.pdf = std::move(templatePdf);
+
+	return entry;
 }
 
-Mat histogramMatching(Mat input, Mat templateImg)
+template <int Bins>
+Mat histogramMatching(Mat input, const TemplateCdf<Bins>& templateCdf)
 {
-	Mat output(input.rows, input.cols, CV_8U);
+	typedef typename dip::HistogramTraits<Bins>::Pixel Pixel;
 
-	//Firstly calculate histogram
-	double* inputHistogram = calculateHistogram(input);
-	double* templateHistogram = calculateHistogram(templateImg);
-
-	//Secondly calculate PDF
-	double* inputPdf = calculatePdf(inputHistogram , input.rows * input.cols);
-	double* templatePdf = calculatePdf(templateHistogram, templateImg.rows * templateImg.cols);
+	Mat output;
 
-	//Thirdly calculate CDF
-	double* inputCdf = calculateCdf(inputPdf);
-	double* templateCdf = calculateCdf(templatePdf);
+	//Firstly calculate histogram
+	auto inputHistogram = dip::calculateHistogram<Bins>(input);
 
+	//Secondly calculate PDF and CDF
+	auto inputCdf = dip::calculateCdf<Bins>(dip::calculatePdf<Bins>(inputHistogram, input.rows * input.cols));
 
-	double mapping[L];
+	std::vector<Pixel> mapping(Bins);
 
 	//Calculate histogram specification function
-	for (auto i = 0; i < L; ++i)
+	//For every input intensity the closest template intensity is the first one whose G(zq) reaches (Bins - 1) * s(rk) or the one just before it
+	//s(rk) never decreases, so the search continues where the previous intensity has left
+	auto j = 0;
+
+	for (auto i = 0; i < Bins; ++i)
 	{
-		auto hIntensity = (L - 1) * inputCdf[i];
-		auto correspondingIdx = 0;
-		auto minDifference = 256.0;
-		for (auto j = 0; j < L; ++j)
-		{
-			auto currentIntensity = (L - 1) * templateCdf[j];
-			auto difference = std::abs(currentIntensity - hIntensity);
-			if (difference < minDifference)
-			{
-				correspondingIdx = j;
-				minDifference = difference;
-			}
-		}
+		auto hIntensity = (Bins - 1) * inputCdf[i];
 
-		mapping[i] = correspondingIdx;
+		while (j < Bins - 1 && templateCdf.levels[j] < hIntensity)
+			++j;
+
+		auto correspondingIdx = j;
+
+		if (templateCdf.levels[j] < hIntensity)
+			correspondingIdx = templateCdf.runStart[j];
+		else if (j > 0 && hIntensity - templateCdf.levels[j - 1] <= templateCdf.levels[j] - hIntensity)
+			correspondingIdx = templateCdf.runStart[j - 1];
+
+		mapping[i] = static_cast<Pixel>(correspondingIdx);
 	}
 
 	//Apply histogram matching function to input
-	for (auto y = 0; y < input.rows; ++y)
+	dip::applyMapping(input, mapping, output);
+
+	return output;
+}
+
+template <int Bins>
+Mat histogramMatching(Mat input, Mat templateImg, TemplateCdfCache<Bins>& cache)
+{
+	return histogramMatching<Bins>(input, cache.get(templateImg));
+}
+
+template <int Bins>
+std::vector<Mat> histogramMatching(const std::vector<Mat>& inputs, Mat templateImg, TemplateCdfCache<Bins>& cache)
+{
+	const auto& templateCdf = cache.get(templateImg);
+	std::vector<Mat> outputs;
+
+	outputs.reserve(inputs.size());
+
+	for (const auto& input : inputs)
 	{
-		for (auto x = 0; x < input.cols; ++x)
-		{
-			output.at<uchar>(y, x) = mapping[input.at<uchar>(y , x)];
-		}
+		outputs.push_back(histogramMatching<Bins>(input, templateCdf));
 	}
 
-	double* outputHistogram = calculateHistogram(output);
-	double* outputPdf = calculatePdf(outputHistogram, output.rows * output.cols);
+	return outputs;
+}
 
-	imshow("Input Histogram", dip::drawHistogram(inputPdf, L));
-	imshow("Template Histogram", dip::drawHistogram(templatePdf, L));
-	imshow("Output Histogram", dip::drawHistogram(outputPdf, L));
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("histogram-matching", largestSize);
 
+	//The template is the negative of a synthetic image, so the mapping is not the identity
+	Mat templateImg;
+	dip::syntheticImage(512).convertTo(templateImg, CV_8U, -1, 255);
 
-	return output;
-}
\ No newline at end of file
+	//The template CDF is computed by the first run, as it is for every input of a batch
+	TemplateCdfCache<256> cache;
+
+	benchmark.run("matching", [&](const Mat& f) { return histogramMatching<256>(f, templateImg, cache); });
+
+	return 0;
+}
@@ -30,6 +30,7 @@
 #include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "utility.h"
+#include "benchmark.h"
 
 #define L 256
 
@@ -63,6 +64,9 @@ double calculateSampleVarianceSquare(Mat input, double m);
 //Equation : 3.3-24
 Mat imageEnchancement(Mat input, int sxy, double E, double k0, double mG, double k1, double k2, double vG);
 
+//Measures the statistics and the enhancement on synthetic images against cv::calcHist and cv::meanStdDev, see dip::Benchmark
+int benchmark(int largestSize);
+
 int main(int argc, char** argv) {
         const String keys = 
 	"{help h usage ?    || The program does image enchanchement with using histogram statistics. Default parameters are set as the book suggested.}"
@@ -72,6 +76,8 @@ int main(int argc, char** argv) {
 	"{k0                | 0.4                      | minimum acceptable mean, which is k0*mG}"
 	"{k1                | 0.02                     | lower bound of acceptable variance, which is k1*vG}"
 	"{k2                | 0.4                      | upper bound of acceptable variance, which is k2*vG}"
+	"{bench             |                          | measure the statistics and the enhancement on synthetic images instead of showing them}"
+	"{benchLargest      | 16384                    | size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -82,6 +88,9 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
 	Mat input , templateImg;
     input = imread(cmdParser.get<cv::String>("input").c_str());
 
@@ -276,3 +285,50 @@ Mat imageEnchancement(Mat input, int sxySize, double E, double k0, double mG, do
 
 	return output;
 }
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("histogram-statistics", largestSize);
+
+	benchmark.run("histogram", [](const Mat& f) {
+		auto histogram = calculateHistogram(f);
+		Mat h = Mat(1, L, CV_64F, histogram).clone();
+		delete[] histogram;
+
+		return h;
+	}, [](const Mat& f) {
+		const int channels[] = { 0 };
+		const int size[] = { L };
+		const float range[] = { 0, L };
+		const float* ranges[] = { range };
+		Mat h;
+		calcHist(&f, 1, channels, Mat(), h, 1, size, ranges);
+
+		return h;
+	});
+	benchmark.run("sample mean and variance", [](const Mat& f) {
+		auto m = calculateSampleMean(f);
+		Mat statistics = (Mat_<double>(1, 2) << m, calculateSampleVarianceSquare(f, m));
+
+		return statistics;
+	}, [](const Mat& f) {
+		Scalar m, s;
+		meanStdDev(f, m, s);
+		Mat statistics = (Mat_<double>(1, 2) << m[0], s[0] * s[0]);
+
+		return statistics;
+	});
+	//Every pixel takes the statistics of its 3x3 region, the global statistics are computed as in the program
+	benchmark.run("enhancement 3x3", [](const Mat& f) {
+		auto histogram = calculateHistogram(f);
+		auto pdf = calculatePdf(histogram, f.rows * f.cols);
+		auto mG = calculateMean(pdf);
+		auto varianceG = std::sqrt(calculateVarianceSquare(pdf, mG));
+		delete[] histogram;
+		delete[] pdf;
+
+		return imageEnchancement(f, 3, 4.0, 0.4, mG, 0.02, 0.4, varianceG);
+	}, dip::Benchmark::Algorithm(), 4096);
+
+	return 0;
+}
@@ -29,6 +29,7 @@
 #include <math.h>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utility.hpp>
+#include "benchmark.h"
 
 using namespace cv;
 
@@ -41,6 +42,8 @@ Mat logTransformation(Mat input , double gamma);
 Mat contrastStretching(Mat input);
 //Intensity Slicing, Figure 3.11(a) implementation
 Mat intensitySlicing(Mat input , int from , int to);
+//Measures the transformations on synthetic images, the point transformations against cv::LUT, see dip::Benchmark
+int benchmark(int largestSize);
 
 int main(int argc, char** argv) {
         const String keys = 
@@ -50,6 +53,8 @@ int main(int argc, char** argv) {
 	"{input2            | contrast-stretching.jpg           | power and log transforming image}"
 	"{slicingFrom       | 50								| A value of interval [A , B]}"
 	"{slicingTo         | 81								| B value of interval [A , B]}"
+	"{bench             |									| measure the transformations on synthetic images instead of showing them}"
+	"{benchLargest      | 16384								| size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -60,6 +65,9 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
 	Mat input , input2;
 
     input = imread(cmdParser.get<cv::String>("input").c_str());
@@ -223,4 +231,40 @@ Mat intensitySlicing(Mat input , int from, int to)
 	}
 
 	return result;
-}
\ No newline at end of file
+}
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("intensity-transformation", largestSize);
+
+	const auto gamma = 1.15;
+
+	//The OpenCV way of a point transformation, the table of the 256 intensities is built in every run
+	auto lookUp = [](const Mat& f, auto transform) {
+		Mat table(1, 256, CV_8U);
+
+		for (auto i = 0; i < 256; ++i)
+		{
+			table.at<uchar>(0, i) = saturate_cast<uchar>(transform(i));
+		}
+
+		Mat g;
+		LUT(f, table, g);
+
+		return g;
+	};
+
+	//Both of the transformations compute two images of doubles
+	benchmark.run("power", [gamma](const Mat& f) { return powerTransformation(f, gamma); },
+		[&](const Mat& f) { return lookUp(f, [gamma](double r) { return std::pow(r, gamma); }); }, 4096);
+	benchmark.run("log", [gamma](const Mat& f) { return logTransformation(f, gamma); },
+		[&](const Mat& f) { return lookUp(f, [](double r) { return 255 * std::log(r / 255 + 1); }); }, 4096);
+	benchmark.run("contrast stretching", [](const Mat& f) { return contrastStretching(f); }, [](const Mat& f) {
+		Mat g;
+		normalize(f, g, 0, 255, NORM_MINMAX);
+		return g;
+	});
+	benchmark.run("intensity slicing", [](const Mat& f) { return intensitySlicing(f, 50, 81); });
+
+	return 0;
+}
@@ -29,6 +29,7 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utility.hpp>
 #include "utility.h"
+#include "benchmark.h"
 
 using namespace cv;
 
@@ -44,6 +45,9 @@ Mat bilinearInterpolation(Mat input, int targetWidth, int targetHeight);
 */
 Mat bicubicInterpolation(Mat input, int targetWidth, int targetHeight);
 
+//Measures the interpolators on synthetic images against cv::resize, see dip::Benchmark
+int benchmark(int largestSize);
+
 int main(int argc, char** argv) {
 
 	const String keys =
@@ -51,6 +55,8 @@ int main(int argc, char** argv) {
 		"{width             | 640               | width of the target image}"
 		"{height            | 480               | height of the target image}"
 		"{path              | interpolation.jpg | path to the used image}"
+		"{bench             |                   | measure the interpolators on synthetic images instead of showing them}"
+		"{benchLargest      | 16384             | size of the largest synthetic image}"
 		;
 
 	CommandLineParser cmdParser(argc, argv, keys);
@@ -62,6 +68,9 @@ int main(int argc, char** argv) {
 		return 0;
 	}
 
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
 	if (cmdParser.has("path"))
 	{
 		input = imread(cmdParser.get<cv::String>("path").c_str());
@@ -332,4 +341,27 @@ Mat bicubicInterpolation(Mat input, int targetWidth, int targetHeight)
 	}
 
 	return output;
-}
\ No newline at end of file
+}
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("interpolation", largestSize);
+
+	//The images are enlarged twice in both directions, the outputs of 16384x16384 would be 1 GB
+	const auto largestInput = 4096;
+
+	auto resized = [](const Mat& f, int interpolation) {
+		Mat g;
+		resize(f, g, Size(f.cols * 2, f.rows * 2), 0, 0, interpolation);
+		return g;
+	};
+
+	benchmark.run("nearest neighbour", [](const Mat& f) { return nearestNeightbourInterpolation(f, f.cols * 2, f.rows * 2); },
+		[&](const Mat& f) { return resized(f, INTER_NEAREST); }, largestInput);
+	benchmark.run("bilinear", [](const Mat& f) { return bilinearInterpolation(f, f.cols * 2, f.rows * 2); },
+		[&](const Mat& f) { return resized(f, INTER_LINEAR); }, largestInput);
+	benchmark.run("bicubic", [](const Mat& f) { return bicubicInterpolation(f, f.cols * 2, f.rows * 2); },
+		[&](const Mat& f) { return resized(f, INTER_CUBIC); }, largestInput);
+
+	return 0;
+}
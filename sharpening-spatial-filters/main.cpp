@@ -26,28 +26,57 @@
  */
 
 #include <iostream>
+#include <cmath>
+#include <limits>
+#include <vector>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "utility.h"
+#include "FixedKernel.h"
+#include "FixedKernel8u.h"
+#include "gradient.h"
+#include "gaussian.h"
+#include "benchmark.h"
 
 using namespace cv;
 
 /*
-* 3.37a
+* 3.37a and 3.6-16, 3.6-17 => 3.6-18 Equation
+* The Laplacian, Gx and Gy are applied in a single int16 SIMD pass over the 8-bit f which loads every neighbourhood once,
+* the Laplacian is kept in an int16 buffer and the gradient is written as 8-bit.
+* The sharpened image f + scaled Laplacian is scaled to 0..255 again, its extremes depend on the extremes of the Laplacian.
+* For a value of the Laplacian the sum grows with f, so the smallest and the largest f of every value are tracked while
+* streaming and the extremes of the sum are found from them. A second pass writes both of the 8-bit outputs.
 */
-Mat iterateMask(Mat f, Mat w);
+void sharpen(Mat f, dip::BorderMode border, Mat& laplacianScaled, Mat& sharpened, Mat& gradient);
+
+/*
+* Equations 10.2-10 and 10.2-11, the L2 magnitude of the Sobel gradient and its direction in bins sectors
+* Both are scaled to 0..255 to be shown
+*/
+void polarGradient(Mat f, int bins, dip::BorderMode border, Mat& magnitude, Mat& orientation);
+
 /*
-* 3.6-16, 3.6-17 => 3.6-18 Equation
+* Canny edge detector in 10.2.6, f is smoothed by a Gaussian of sigma and its gradient is thinned and thresholded in a single pass
 */
-Mat iterateMaskForGradient(Mat f);
-double applyFilter(Mat f, Mat w);
+Mat detectEdges(Mat f, double sigma, double lowThreshold, double highThreshold, dip::BorderMode border);
+
+//Measures the sharpening and the gradients on synthetic images against the OpenCV filters, see dip::Benchmark
+int benchmark(int largestSize);
 
 int main(int argc, char** argv) 
 {
         const String keys = 
 	"{help h usage ?    || Program does sharpening spatial filters by using Laplacian Derivation and applies the filter as stated in the figure 3.37b.}"
 	"{input             | sharpening-spatial-filters.jpg | input image}"
+	"{bins              | 8 | number of the sectors the gradient direction is quantised into, 1..256}"
+	"{cannySigma        | 1.4 | sigma of the gaussian smoothing of canny}"
+	"{lowThreshold      | 40 | gradient magnitude of the edge candidates of canny}"
+	"{highThreshold     | 100 | gradient magnitude of the edges of canny}"
+	"{border            | constant | border mode of the masks : constant, replicate, reflect or wrap}"
+	"{bench             |          | measure the filters on synthetic images instead of showing them}"
+	"{benchLargest      | 16384    | size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -58,6 +87,9 @@ int main(int argc, char** argv)
         return 0;
     }
 
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
 	Mat input = imread(cmdParser.get<cv::String>("input").c_str());
 
 	if (!input.data)
@@ -66,157 +98,194 @@ int main(int argc, char** argv)
 		return -1;
 	}
 
+	auto bins = cmdParser.get<int>("bins");
+	auto cannySigma = cmdParser.get<double>("cannySigma");
+	auto lowThreshold = cmdParser.get<double>("lowThreshold");
+	auto highThreshold = cmdParser.get<double>("highThreshold");
+	auto border = dip::parseBorderMode(cmdParser.get<cv::String>("border"));
+
 	cvtColor(input, input, COLOR_BGR2GRAY);
 	imshow("input", input);
-	
-
-	Mat laplacianInput;
-	input.copyTo(laplacianInput);
-	laplacianInput.convertTo(laplacianInput, CV_64FC1);
-
-	//Apply laplacian filter
-	//Figure: 3.37b
-	Mat laplacianOrthogonalMask = (Mat_<int>(3, 3) <<
-		-1, -1, -1,
-		-1,  8, -1,
-		-1, -1, -1);
-
-	auto laplacianOrthogonalApplied = iterateMask(laplacianInput, laplacianOrthogonalMask);
-
-	auto orthogonalMin = .0;
-	auto orthogonalMax = .0;
-
-	minMaxLoc(laplacianOrthogonalApplied, &orthogonalMin, &orthogonalMax);
-	
-	laplacianOrthogonalApplied = (laplacianOrthogonalApplied - orthogonalMin);
-	minMaxLoc(laplacianOrthogonalApplied, &orthogonalMin, &orthogonalMax);
-	laplacianOrthogonalApplied = laplacianOrthogonalApplied * (255.0 / orthogonalMax);
 
-	Mat sharpenedOrthogonal = laplacianInput + laplacianOrthogonalApplied;
+	//Apply laplacian filter(Figure: 3.37b) and gradient filter
+	Mat laplacianOrthogonalApplied;
+	Mat sharpenedOrthogonal;
+	Mat gradientApplied;
 
-	minMaxLoc(sharpenedOrthogonal, &orthogonalMin, &orthogonalMax);
+	sharpen(input, border, laplacianOrthogonalApplied, sharpenedOrthogonal, gradientApplied);
 
-	sharpenedOrthogonal = (sharpenedOrthogonal - orthogonalMin);
-	minMaxLoc(sharpenedOrthogonal, &orthogonalMin, &orthogonalMax);
-	sharpenedOrthogonal = sharpenedOrthogonal * (255.0 / orthogonalMax);
-
-	sharpenedOrthogonal.convertTo(sharpenedOrthogonal, CV_8U);
-	laplacianOrthogonalApplied.convertTo(laplacianOrthogonalApplied, CV_8U);
-
-	//Apply gradient filter
-	auto gradientApplied = iterateMaskForGradient(laplacianInput);
-
-	gradientApplied.convertTo(gradientApplied, CV_8U);
 	imshow("Laplacian Orthogonal Mask Applied Scaled", laplacianOrthogonalApplied);
 	imshow("Sharpened By Orthogonal", sharpenedOrthogonal);
 	imshow("Gradient applied", gradientApplied);
 
+	Mat gradientMagnitude;
+	Mat gradientOrientation;
+
+	polarGradient(input, bins, border, gradientMagnitude, gradientOrientation);
+
+	imshow("Gradient L2 Magnitude", gradientMagnitude);
+	imshow("Gradient Orientation", gradientOrientation);
+	imshow("Canny Edges", detectEdges(input, cannySigma, lowThreshold, highThreshold, border));
+
     waitKey(0);
 
     return 0;
 }
 
-Mat iterateMask(Mat f, Mat w)
+void sharpen(Mat f, dip::BorderMode border, Mat& laplacianScaled, Mat& sharpened, Mat& gradient)
 {
+	Mat laplacian;
 
-	auto m = w.cols;
-	auto n = w.rows;
-	auto a = (m - 1) / 2;
-	auto b = (n - 1) / 2;
-	auto padSize = w.rows - 1;
-	Mat fPadded = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_64F);
-	Mat g = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_64F);
-
-	//Pad is adding
-	auto roi = fPadded(Rect(w.cols - 1, w.rows - 1, f.cols, f.rows));
-	f.copyTo(roi);
-
-	//Start with some margin, because we padded the Mat
-	//Iterate all the points
-	for (auto y = padSize - 1; y < fPadded.rows - padSize + 1; ++y)
-	{
-		for (auto x = padSize - 1; x < fPadded.cols - padSize + 1; ++x)
-		{
-			//Get the Mat which consist of neighbours of the point
-			Mat neighbourhood = fPadded(Rect(x - a, y - b, w.cols, w.cols));
+	//Convolution is the correlation with the rotated masks
+	typedef dip::RotatedKernel<dip::LaplacianKernel> Laplacian;
+	typedef dip::RotatedKernel<dip::SobelXKernel> Gx;
+	typedef dip::RotatedKernel<dip::SobelYKernel> Gy;
 
-			//Apply the filter
-			g.at<double>(y, x) = applyFilter(neighbourhood , w);
-		}
+	//Range of the Laplacian of an 8-bit image
+	auto lowest = 0;
+	auto highest = 0;
+
+	for (auto i = 0; i < Laplacian::size * Laplacian::size; ++i)
+	{
+		(Laplacian::coefficient(i) < 0 ? lowest : highest) += Laplacian::coefficient(i) * 255;
 	}
 
-	//Return unpadded Mat
-	return g(Rect(padSize, padSize, f.cols, f.rows));
-}
+	//The smallest and the largest f of every value of the Laplacian
+	std::vector<int> smallest(highest - lowest + 1, 256);
+	std::vector<int> largest(highest - lowest + 1, -1);
+	auto laplacianMin = highest;
+	auto laplacianMax = lowest;
 
-Mat iterateMaskForGradient(Mat f)
-{
-	//Equation: 3.6-16
-	Mat gx = (Mat_<int>(3, 3) <<
-		-1, -2, -1,
-		0, 0, 0,
-		1, 2, 1);
-
-	//Equation: 3.6-17
-	Mat gy = (Mat_<int>(3, 3) <<
-		-1, 0, 1,
-		-2, 0, 2,
-		-1, 0, 1);
-
-
-	auto m = gy.cols;
-	auto n = gy.rows;
-	auto a = (m - 1) / 2;
-	auto b = (n - 1) / 2;
-	auto padSize = gy.rows - 1;
-	Mat fPadded = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_64F);
-	Mat M = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_64F);
-
-	//Pad is adding
-	auto roi = fPadded(Rect(gx.cols - 1, gx.rows - 1, f.cols, f.rows));
-	f.copyTo(roi);
-
-	//Start with some margin, because we padded the Mat
-	//Iterate all the points
-	for (auto y = padSize - 1; y < fPadded.rows - padSize + 1; ++y)
-	{
-		for (auto x = padSize - 1; x < fPadded.cols - padSize + 1; ++x)
+	//Put Eq 3.6-16 and Eq 3.6-17 into the Eq 3.6-18, the gradient is computed in the pass of the Laplacian
+	dip::correlateGradient8u<Laplacian, Gx, Gy>(f, laplacian, gradient, [&](int y, int begin, int count) {
+		auto values = f.ptr<uchar>(y) + begin;
+		auto responses = laplacian.ptr<short>(y) + begin;
+
+		for (auto x = 0; x < count; ++x)
 		{
-			//Get the Mat which consist of neighbours of the point
-			Mat neighbourhood = fPadded(Rect(x - a, y - b, gx.cols, gx.cols));
+			auto value = values[x];
+			auto response = static_cast<int>(responses[x]);
 
-			//Find gx, gy
+			laplacianMin = std::min(laplacianMin, response);
+			laplacianMax = std::max(laplacianMax, response);
+			smallest[response - lowest] = std::min<int>(smallest[response - lowest], value);
+			largest[response - lowest] = std::max<int>(largest[response - lowest], value);
+		}
+	}, border);
 
-			//Calculate  Eq 3.6-16
-			auto gxValue = applyFilter(neighbourhood, gx);
-			//Calculate Eq 3.6-17
-			auto gyValue = applyFilter(neighbourhood, gy);
+	//The Laplacian is shifted to 0 and scaled to 0..255
+	auto laplacianScale = laplacianMax > laplacianMin ? 255.0 / (laplacianMax - laplacianMin) : .0;
+	auto scaled = [&](int response) {
+		return (response - laplacianMin) * laplacianScale;
+	};
 
-			//Put the outputs into the Eq 3.6-18
-			M.at<double>(y, x) = dip::stayInBoundaries(std::abs(gxValue) + std::abs(gyValue) , dip::Upper(255) , dip::Lower(0));
-		}
-	}
+	auto sharpenedMin = std::numeric_limits<double>::max();
+	auto sharpenedMax = std::numeric_limits<double>::lowest();
 
-	//Return unpadded Mat
-	return M(Rect(padSize, padSize, f.cols, f.rows));
-}
+	for (auto response = laplacianMin; response <= laplacianMax; ++response)
+	{
+		if (largest[response - lowest] < 0)
+			continue;
 
-double applyFilter(Mat f, Mat w)
-{
-	auto result = .0;
+		sharpenedMin = std::min(sharpenedMin, smallest[response - lowest] + scaled(response));
+		sharpenedMax = std::max(sharpenedMax, largest[response - lowest] + scaled(response));
+	}
+
+	auto sharpenedScale = sharpenedMax > sharpenedMin ? 255.0 / (sharpenedMax - sharpenedMin) : .0;
 
-	cv::rotate(w, w, RotateFlags::ROTATE_180);
+	laplacianScaled.create(f.rows, f.cols, CV_8U);
+	sharpened.create(f.rows, f.cols, CV_8U);
 
-	//w(x,y) * f(x,y) = w(s,t) * f(x + s, y + t)  
 	for (auto y = 0; y < f.rows; ++y)
 	{
+		auto input = f.ptr<uchar>(y);
+		auto responses = laplacian.ptr<short>(y);
+		auto laplacianOutput = laplacianScaled.ptr<uchar>(y);
+		auto sharpenedOutput = sharpened.ptr<uchar>(y);
+
 		for (auto x = 0; x < f.cols; ++x)
 		{
-			auto wi = w.at<int>(y, x);
-			auto fi = f.at<double>(y, x);
-			result += wi * fi;
+			auto laplacianValue = scaled(responses[x]);
+
+			laplacianOutput[x] = saturate_cast<uchar>(laplacianValue);
+			sharpenedOutput[x] = saturate_cast<uchar>((input[x] + laplacianValue - sharpenedMin) * sharpenedScale);
 		}
 	}
+}
+
+void polarGradient(Mat f, int bins, dip::BorderMode border, Mat& magnitude, Mat& orientation)
+{
+	Mat length;
+	Mat sector;
+
+	dip::sobelGradient(f, length, sector, bins, border);
+
+	//The largest magnitude is 4 * 255 * sqrt(2)
+	length.convertTo(magnitude, CV_8U, 255.0 / (4 * 255 * std::sqrt(2.0)));
+	sector.convertTo(orientation, CV_8U, bins > 1 ? 255.0 / (bins - 1) : .0);
+}
+
+Mat detectEdges(Mat f, double sigma, double lowThreshold, double highThreshold, dip::BorderMode border)
+{
+	return dip::canny(dip::gaussianFilter(f, sigma, border), lowThreshold, highThreshold, border);
+}
 
-	return result;
-}
\ No newline at end of file
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("sharpening-spatial-filters", largestSize);
+
+	const auto border = dip::BorderMode::Constant;
+
+	auto sobel = [](const Mat& f, int type, Mat& gx, Mat& gy) {
+		Sobel(f, gx, type, 1, 0, 3, 1, 0, BORDER_CONSTANT);
+		Sobel(f, gy, type, 0, 1, 3, 1, 0, BORDER_CONSTANT);
+	};
+
+	//The sharpened image, the Laplacian and the gradient are all written
+	benchmark.run("sharpen", [&](const Mat& f) {
+		Mat laplacian, sharpened, gradient;
+		sharpen(f, border, laplacian, sharpened, gradient);
+		return sharpened;
+	}, [&](const Mat& f) {
+		Mat laplacian, laplacianScaled, gx, gy, gradient, sum, sharpened;
+		filter2D(f, laplacian, CV_16S, dip::kernelMat<dip::LaplacianKernel>(CV_32F), Point(-1, -1), 0, BORDER_CONSTANT);
+		sobel(f, CV_16S, gx, gy);
+		convertScaleAbs(gx, gx);
+		convertScaleAbs(gy, gy);
+		add(gx, gy, gradient);
+		//f plus the Laplacian scaled to 0..255, scaled to 0..255 again as in sharpen
+		normalize(laplacian, laplacianScaled, 0, 255, NORM_MINMAX, CV_64F);
+		f.convertTo(sum, CV_64F);
+		add(sum, laplacianScaled, sum);
+		normalize(sum, sharpened, 0, 255, NORM_MINMAX, CV_8U);
+		return sharpened;
+	});
+	benchmark.run("gradient |gx| + |gy|", [&](const Mat& f) {
+		return dip::gradient8u<dip::RotatedKernel<dip::SobelXKernel>, dip::RotatedKernel<dip::SobelYKernel>>(f, border);
+	}, [&](const Mat& f) {
+		Mat gx, gy, gradient;
+		sobel(f, CV_16S, gx, gy);
+		convertScaleAbs(gx, gx);
+		convertScaleAbs(gy, gy);
+		add(gx, gy, gradient);
+		return gradient;
+	});
+	benchmark.run("gradient L2 and orientation", [&](const Mat& f) {
+		Mat magnitude, orientation;
+		dip::sobelGradient(f, magnitude, orientation, 8, border);
+		return magnitude;
+	}, [&](const Mat& f) {
+		Mat gx, gy, magnitude, orientation;
+		sobel(f, CV_32F, gx, gy);
+		cartToPolar(gx, gy, magnitude, orientation, true);
+		return magnitude;
+	});
+	//Both use the L2 magnitude of the Sobel gradient
+	benchmark.run("canny 40, 100", [&](const Mat& f) { return dip::canny(f, 40, 100, border); }, [](const Mat& f) {
+		Mat edges;
+		Canny(f, edges, 40, 100, 3, true);
+		return edges;
+	});
+
+	return 0;
+}
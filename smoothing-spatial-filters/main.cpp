@@ -30,40 +30,94 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utility.hpp>
 #include "utility.h"
+#include "border.h"
+#include "box.h"
+#include "convolution.h"
+#include "FixedKernel8u.h"
+#include "median.h"
+#include "extremum.h"
+#include "gaussian.h"
+#include "bilateral.h"
+#include "denoise.h"
+#include "benchmark.h"
 
 using namespace cv;
 
 /*
-* Mask in the Figure 3.32a
+* Mask in the Figure 3.32a, size x size
+* The 3x3 mask is the fixed kernel, the larger ones are running sums whose cost doesn't depend on the size
 */
-Mat applyBoxMask(Mat input);
+Mat applyBoxMask(Mat input, int size, dip::BorderMode border);
 
 /*
 * Mask in the Figure 3.32b
 */
-Mat applyWeightedAverageMask(Mat input);
+Mat applyWeightedAverageMask(Mat input, dip::BorderMode border);
 
 /*
-* Median Mask in 3.5.2
+* Gaussian mask of any sigma, computed by recursive filters whose cost doesn't depend on sigma(a sampled mask below sigma 3)
 */
-Mat applyMedian(Mat f, int size);
+Mat applyGaussian(Mat input, double sigma, dip::BorderMode border);
 
 /*
-* Equation : 3.5-1
+* Edge preserving bilateral filter, the neighbours are weighted by their distance in space and in intensity
+* It is computed on a downsampled grid of space x intensity, so the cost doesn't depend on the spatial sigma
 */
-int applyMask(Mat input, Mat mask);
+Mat applyBilateral(Mat input, double spaceSigma, double rangeSigma);
+
+/*
+* Non-local means, the neighbours in the search window are weighted by the similarity of the patches around them
+*/
+Mat applyNonLocalMeans(Mat input, int patchSize, int searchSize, double h, dip::BorderMode border);
+
+/*
+* Median Mask in 3.5.2, the cost of a pixel doesn't depend on the size
+*/
+Mat applyMedian(Mat f, int size, dip::BorderMode border);
+
+/*
+* Max and min filters in 3.5.2, the 100th and the 0th percentile of the neighbourhood
+* Both cost about three comparisons per pixel for every size
+*/
+Mat applyMax(Mat f, int size, dip::BorderMode border);
+Mat applyMin(Mat f, int size, dip::BorderMode border);
+
+/*
+* Any percentile of the neighbourhood, counted in the same histograms as the median
+*/
+Mat applyPercentile(Mat f, int size, double percentile, dip::BorderMode border);
 
 //Utility
 void printMat(Mat input);
 
-//Iterates all points of f(x,y) and applies the w(x , y)
-Mat iterateLinearMask(Mat f, Mat w);
+//Iterates all points of f(x,y) and applies the w(x , y), Equation : 3.5-1
+//The pixels outside f are generated by the border mode, f is not padded
+Mat iterateLinearMask(Mat f, Mat w, dip::BorderMode border);
+
+//Same as above for a kernel known at compile time, the 3x3 masks are vectorized and normalised by a fixed-point multiply-shift
+template <typename Kernel>
+Mat iterateLinearMask(Mat f, dip::BorderMode border);
+
+//Measures the masks on synthetic images against the OpenCV filters, see dip::Benchmark
+int benchmark(int largestSize);
 
 int main(int argc, char** argv) {
         const String keys = 
 	"{help h usage ?    || The program apply smoothing spatial filters to the image.}"
     "{input             | smoothing-spatial-filter.jpg | an image which the filters will be applied}"
 	"{medianSize        | 9 | size of median mask}"
+	"{boxSize           | 3 | size of box mask}"
+	"{sigma             | 5 | sigma of gaussian mask}"
+	"{spaceSigma        | 16 | spatial sigma of bilateral filter}"
+	"{rangeSigma        | 20 | intensity sigma of bilateral filter}"
+	"{patchSize         | 7 | patch size of non-local means}"
+	"{searchSize        | 21 | search window size of non-local means}"
+	"{strength          | 10 | filtering strength(h) of non-local means}"
+	"{orderSize         | 15 | size of max, min and percentile masks}"
+	"{percentile        | 10 | percentile of the percentile mask}"
+	"{border            | constant | border mode of the masks : constant, replicate, reflect or wrap}"
+	"{bench             |          | measure the masks on synthetic images instead of showing them}"
+	"{benchLargest      | 16384    | size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -74,6 +128,9 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
 	Mat input , input2;
 
     input = imread(cmdParser.get<cv::String>("input").c_str());
@@ -85,21 +142,47 @@ int main(int argc, char** argv) {
     }
 
 	auto medianSize = cmdParser.get<int>("medianSize");
+	auto boxSize = cmdParser.get<int>("boxSize");
+	auto sigma = cmdParser.get<double>("sigma");
+	auto spaceSigma = cmdParser.get<double>("spaceSigma");
+	auto rangeSigma = cmdParser.get<double>("rangeSigma");
+	auto patchSize = cmdParser.get<int>("patchSize");
+	auto searchSize = cmdParser.get<int>("searchSize");
+	auto strength = cmdParser.get<double>("strength");
+	auto orderSize = cmdParser.get<int>("orderSize");
+	auto percentile = cmdParser.get<double>("percentile");
+	auto border = dip::parseBorderMode(cmdParser.get<cv::String>("border"));
 
     cvtColor(input , input , COLOR_BGR2GRAY);
 	
 	std::cout << "Box mask is being applied..." << std::endl;
-	auto boxMaskApplied = applyBoxMask(input);
+	auto boxMaskApplied = applyBoxMask(input, boxSize, border);
 	std::cout << "-----------------------------------------" << std::endl;
 	std::cout << "Weighted average mask is being applied..." << std::endl;
-	auto weightedAverageMaskApplied = applyWeightedAverageMask(input);
+	auto weightedAverageMaskApplied = applyWeightedAverageMask(input, border);
+	std::cout << "Gaussian mask is being applied..." << std::endl;
+	auto gaussianMaskApplied = applyGaussian(input, sigma, border);
+	std::cout << "Bilateral filter is being applied..." << std::endl;
+	auto bilateralApplied = applyBilateral(input, spaceSigma, rangeSigma);
+	std::cout << "Non-local means is being applied..." << std::endl;
+	auto nonLocalMeansApplied = applyNonLocalMeans(input, patchSize, searchSize, strength, border);
 	std::cout << "Median mask is being applied..." << std::endl;
-	auto medianMaskApplied = applyMedian(input, medianSize);
+	auto medianMaskApplied = applyMedian(input, medianSize, border);
+	std::cout << "Max, min and percentile masks are being applied..." << std::endl;
+	auto maxMaskApplied = applyMax(input, orderSize, border);
+	auto minMaskApplied = applyMin(input, orderSize, border);
+	auto percentileMaskApplied = applyPercentile(input, orderSize, percentile, border);
 
     imshow("input" , input);
 	imshow("Box Mask Applied", boxMaskApplied);
 	imshow("Weighted Average Mask Applied", weightedAverageMaskApplied);
+	imshow("Gaussian Mask Applied", gaussianMaskApplied);
+	imshow("Bilateral Filter Applied", bilateralApplied);
+	imshow("Non-local Means Applied", nonLocalMeansApplied);
 	imshow("Median Mask Applied", medianMaskApplied);
+	imshow("Max Mask Applied", maxMaskApplied);
+	imshow("Min Mask Applied", minMaskApplied);
+	imshow("Percentile Mask Applied", percentileMaskApplied);
 
     waitKey(0);
 
@@ -107,110 +190,74 @@ int main(int argc, char** argv) {
 }
 
 
-Mat applyBoxMask(Mat input)
+Mat applyBoxMask(Mat input, int size, dip::BorderMode border)
 {
-	Mat boxMask = (Mat_<uchar>(3, 3)
-		<<	1, 1, 1,
-			1, 1, 1,
-			1, 1, 1);
+	if (size != 3)
+	{
+		std::cout << "Box Mask => " << size << "x" << size << " ones" << std::endl;
+		std::cout << "Coefficient is " << 1 << "/" << size * size << std::endl;
+
+		return dip::boxFilter(input, Size(size, size), border);
+	}
 
 	std::cout << "Box Mask => " << std::endl;
-	printMat(boxMask);
+	printMat(dip::kernelMat<dip::BoxKernel>(CV_8U));
 
-	return iterateLinearMask(input, boxMask);
+	return iterateLinearMask<dip::BoxKernel>(input, border);
 }
 
-Mat applyWeightedAverageMask(Mat input)
+Mat applyWeightedAverageMask(Mat input, dip::BorderMode border)
 {
-	Mat weightedAverageMask = (Mat_<uchar>(3, 3)
-		<< 1, 2, 1,
-		2, 4, 2,
-		1, 2, 1);
-
 	std::cout << "Weighted Average Mask => " << std::endl;
-	printMat(weightedAverageMask);
+	printMat(dip::kernelMat<dip::WeightedAverageKernel>(CV_8U));
 
-	return iterateLinearMask(input, weightedAverageMask);
+	return iterateLinearMask<dip::WeightedAverageKernel>(input, border);
 }
 
-int applyMask(Mat f, Mat w)
+Mat applyGaussian(Mat input, double sigma, dip::BorderMode border)
 {
-	auto result = 0;
+	std::cout << "Gaussian Mask => sigma " << sigma << std::endl;
 
-	//w(x,y) * f(x,y) = w(s,t) * f(x + s, y + t)  
-	for (auto y = 0; y < f.rows; ++y)
-	{
-		for (auto x = 0; x < f.cols; ++x)
-		{
-			result += w.at<uchar>(y, x) * f.at<uchar>(y, x);
-		}
-	}
-
-	return result;
+	return dip::gaussianFilter(input, sigma, border);
 }
 
-Mat applyMedian(Mat f , int size)
+Mat applyBilateral(Mat input, double spaceSigma, double rangeSigma)
 {
-	auto m = size;
-	auto n = size;
-	auto a = (m - 1) / 2;
-	auto b = (n - 1) / 2;
-	auto padSize = size - 1;
-	Mat fPadded = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_8U);
-	Mat g = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_8U);
-
-	//Pad is adding
-	auto roi = fPadded(Rect(size - 1, size - 1, f.rows, f.cols));
-	f.copyTo(roi);
-
-	//Start with some margin, because we padded the Mat
-	//Iterate all the points
-	for (auto y = padSize - 1; y < fPadded.rows - padSize + 1; ++y)
-	{
-		for (auto x = padSize - 1; x < fPadded.cols - padSize + 1; ++x)
-		{
-			//Get the Mat which consist of neighbours of the point
-			Mat neighbourhood = fPadded(Rect(x - a, y - b, size, size));
+	std::cout << "Bilateral Filter => space sigma " << spaceSigma << ", range sigma " << rangeSigma << std::endl;
 
-			std::vector<int> values;
+	return dip::bilateralFilter(input, spaceSigma, rangeSigma);
+}
 
-			for (auto nX = 0; nX < neighbourhood.cols; ++nX)
-			{
-				for (auto nY = 0; nY < neighbourhood.rows; ++nY)
-				{
-					values.push_back(neighbourhood.at<uchar>(nY, nX));
-				}
-			}
+Mat applyNonLocalMeans(Mat input, int patchSize, int searchSize, double h, dip::BorderMode border)
+{
+	std::cout << "Non-local Means => " << patchSize << "x" << patchSize << " patches, " << searchSize << "x" << searchSize << " search window, h " << h << std::endl;
 
-			//Sort values
-			std::sort(values.begin(), values.end(), std::less<int>());
+	return dip::nonLocalMeans(input, patchSize, searchSize, h, border);
+}
 
-			//Find meadian (value at the center of the vector)
-			auto median = values.at(values.size() / 2 + 1);
+Mat applyMedian(Mat f, int size, dip::BorderMode border)
+{
+	//The neighbourhoods are counted in sliding histograms instead of being sorted
+	return dip::medianFilter(f, size, border);
+}
 
-			//Apply the filter
-			g.at<uchar>(y, x) = static_cast<uchar>(median);
-		}
-	}
+Mat applyMax(Mat f, int size, dip::BorderMode border)
+{
+	return dip::maxFilter(f, Size(size, size), border);
+}
 
-	//Return unpadded Mat
-	return g(Rect(padSize, padSize, f.cols, f.rows));
+Mat applyMin(Mat f, int size, dip::BorderMode border)
+{
+	return dip::minFilter(f, Size(size, size), border);
 }
 
-Mat iterateLinearMask(Mat f, Mat w)
+Mat applyPercentile(Mat f, int size, double percentile, dip::BorderMode border)
 {
-	auto m = w.cols;
-	auto n = w.rows;
-	auto a = (m - 1) / 2;
-	auto b = (n - 1) / 2;
-	auto padSize = w.rows - 1;
-	Mat fPadded = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_8U);
-	Mat g = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_8U);
-
-	//Pad is adding
-	auto roi = fPadded(Rect(w.cols - 1, w.rows - 1, f.rows, f.cols));
-	f.copyTo(roi);
+	return dip::percentileFilter(f, size, percentile, border);
+}
 
+Mat iterateLinearMask(Mat f, Mat w, dip::BorderMode border)
+{
 	auto sumOfMultipliers = 0;
 	auto coefficient = .0;
 
@@ -226,22 +273,17 @@ Mat iterateLinearMask(Mat f, Mat w)
 
 	std::cout << "Coefficient is " << 1 << "/" << sumOfMultipliers << std::endl;
 
-	//Start with some margin, because we padded the Mat
-	//Iterate all the points
-	for (auto y = padSize - 1; y < fPadded.rows - padSize + 1; ++y)
-	{
-		for (auto x = padSize - 1; x < fPadded.cols - padSize + 1; ++x)
-		{
-			//Get the Mat which consist of neighbours of the point
-			Mat neighbourhood = fPadded(Rect(x - a, y - b, w.cols, w.cols));
+	return dip::correlate<uchar, int, uchar>(f, w, [coefficient](int result) {
+		return static_cast<uchar>(coefficient * result);
+	}, border);
+}
 
-			//Apply the filter
-			g.at<uchar>(y, x) = coefficient * applyMask(neighbourhood, w);
-		}
-	}
+template <typename Kernel>
+Mat iterateLinearMask(Mat f, dip::BorderMode border)
+{
+	std::cout << "Coefficient is " << 1 << "/" << Kernel::divisor << std::endl;
 
-	//Return unpadded Mat
-	return g(Rect(padSize, padSize, f.cols, f.rows));
+	return dip::correlate8u<Kernel>(f, border);
 }
 
 void printMat(Mat input)
@@ -255,4 +297,72 @@ void printMat(Mat input)
 
 		std::cout << std::endl;
 	}
-}
\ No newline at end of file
+}
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("smoothing-spatial-filters", largestSize);
+
+	const auto border = dip::BorderMode::Constant;
+
+	auto blurred = [](const Mat& f, int size) {
+		Mat g;
+		blur(f, g, Size(size, size), Point(-1, -1), BORDER_CONSTANT);
+		return g;
+	};
+
+	auto median = [](const Mat& f, int size) {
+		Mat g;
+		medianBlur(f, g, size);
+		return g;
+	};
+
+	auto square = getStructuringElement(MORPH_RECT, Size(15, 15));
+
+	//The 3x3 masks are measured without iterateLinearMask, which prints their coefficient
+	benchmark.run("box 3x3", [&](const Mat& f) { return dip::correlate8u<dip::BoxKernel>(f, border); },
+		[&](const Mat& f) { return blurred(f, 3); });
+	benchmark.run("box 15x15", [&](const Mat& f) { return dip::boxFilter(f, Size(15, 15), border); },
+		[&](const Mat& f) { return blurred(f, 15); });
+	//The 3x3 Gaussian of OpenCV is the weighted average mask
+	benchmark.run("weighted average 3x3", [&](const Mat& f) { return dip::correlate8u<dip::WeightedAverageKernel>(f, border); }, [](const Mat& f) {
+		Mat g;
+		GaussianBlur(f, g, Size(3, 3), 0, 0, BORDER_CONSTANT);
+		return g;
+	});
+	benchmark.run("gaussian sigma 5", [&](const Mat& f) { return dip::gaussianFilter(f, 5, border); }, [](const Mat& f) {
+		Mat g;
+		GaussianBlur(f, g, Size(), 5, 5, BORDER_CONSTANT);
+		return g;
+	});
+	//OpenCV sums a disk of 1.5 spatial sigmas around every pixel, it takes minutes on the larger images
+	benchmark.run("bilateral 16, 20", [](const Mat& f) { return dip::bilateralFilter(f, 16, 20); }, [](const Mat& f) {
+		Mat g;
+		bilateralFilter(f, g, -1, 20, 16);
+		return g;
+	}, 4096);
+	//441 patch distances per pixel
+	benchmark.run("non-local means 7, 21", [&](const Mat& f) { return dip::nonLocalMeans(f, 7, 21, 10, border); }, [](const Mat& f) {
+		Mat g;
+		fastNlMeansDenoising(f, g, 10, 7, 21);
+		return g;
+	}, 1024);
+	for (auto size : { 3, 5, 9 })
+	{
+		benchmark.run("median " + std::to_string(size) + "x" + std::to_string(size), [&](const Mat& f) { return dip::medianFilter(f, size, border); },
+			[&](const Mat& f) { return median(f, size); });
+	}
+	benchmark.run("max 15x15", [&](const Mat& f) { return dip::maxFilter(f, Size(15, 15), border); }, [&](const Mat& f) {
+		Mat g;
+		dilate(f, g, square);
+		return g;
+	});
+	benchmark.run("min 15x15", [&](const Mat& f) { return dip::minFilter(f, Size(15, 15), border); }, [&](const Mat& f) {
+		Mat g;
+		erode(f, g, square);
+		return g;
+	});
+	benchmark.run("percentile 10 15x15", [&](const Mat& f) { return dip::percentileFilter(f, 15, 10, border); });
+
+	return 0;
+}
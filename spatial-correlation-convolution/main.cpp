@@ -30,16 +30,24 @@
 #include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "utility.h"
+#include "convolution.h"
+#include "benchmark.h"
 
 using namespace cv;
 
 //Equation : 3.3-24
 //https://www.youtube.com/watch?v=gFELyrIx010 is simply explaining how the operations are performed.
-Mat correlate(Mat f , Mat w);
-Mat convolute(Mat f, Mat w);
+Mat correlate(Mat f , Mat w, dip::BorderMode border);
+Mat convolute(Mat f, Mat w, dip::BorderMode border);
+//Both of the above, w is converted, factored and rotated before the pixels are iterated
+Mat applyKernel(Mat f, const dip::Kernel<int>& w, dip::BorderMode border);
+
+//Averages f over a disk of the given diameter, the disk is not separable so large ones are worth filtering in the frequency domain
+Mat applyDiskMask(Mat f, int diameter, dip::CorrelationMethod method, dip::BorderMode border);
+
+//Measures the correlations on synthetic images against cv::filter2D, see dip::Benchmark
+int benchmark(int largestSize);
 
-//Equation : 3.4-1
-uchar applyFilter(Mat f, Mat w);
 Mat rotate(Mat input, double angle);
 
 //Utility
@@ -49,6 +57,12 @@ int main(int argc, char** argv)
 {
         const String keys = 
 	"{help h usage ?    || The program does spatial correlation and convolution, the values are hardcoded into the program as in the figure 3.30.}"
+	"{input             |      | an image which is averaged with a disk mask instead of the hardcoded values}"
+	"{kernelSize        | 31   | diameter of the disk mask}"
+	"{method            | auto | direct, fft or auto(chosen by the measured crossover)}"
+	"{border            | constant | border mode : constant, replicate, reflect or wrap}"
+	"{bench             |          | measure the correlations on synthetic images instead of showing them}"
+	"{benchLargest      | 16384    | size of the largest synthetic image}"
     ;
 
     CommandLineParser cmdParser(argc , argv, keys);
@@ -59,6 +73,44 @@ int main(int argc, char** argv)
         return 0;
     }
 
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
+	auto border = dip::parseBorderMode(cmdParser.get<cv::String>("border"));
+
+	if (cmdParser.has("input"))
+	{
+		Mat input = imread(cmdParser.get<cv::String>("input"), IMREAD_GRAYSCALE);
+
+		if (!input.data)
+		{
+			printf("No input data \n");
+			return -1;
+		}
+
+		auto kernelSize = cmdParser.get<int>("kernelSize");
+		auto method = dip::parseCorrelationMethod(cmdParser.get<cv::String>("method"));
+
+		if (method == dip::CorrelationMethod::Automatic)
+		{
+			method = dip::chooseCorrelationMethod(input.size(), Size(kernelSize, kernelSize), false);
+			std::cout << (method == dip::CorrelationMethod::Fft ? "fft" : "direct") << " method is chosen" << std::endl;
+		}
+
+		auto start = getTickCount();
+		auto averaged = applyDiskMask(input, kernelSize, method, border);
+		auto elapsed = (getTickCount() - start) / getTickFrequency();
+
+		std::cout << "Disk mask is applied in " << elapsed * 1000 << " ms" << std::endl;
+
+		imshow("input", input);
+		imshow("Disk Mask Applied", averaged);
+
+		waitKey(0);
+
+		return 0;
+	}
+
 	Mat f = (Mat_<uchar>(5, 5) <<	0, 0, 0, 0, 0,
 									0, 0, 0, 0, 0,
 									0, 0, 1, 0, 0,
@@ -70,8 +122,8 @@ int main(int argc, char** argv)
 									4 , 5 , 6 ,
 									7 , 8 , 9);
 
-	auto correlated = correlate(f, w);
-	auto convoluted = convolute(f, w);
+	auto correlated = correlate(f, w, border);
+	auto convoluted = convolute(f, w, border);
 
 	std::cout << "f(x,y) => " << std::endl;
 	printMat(f);
@@ -88,61 +140,46 @@ int main(int argc, char** argv)
     return 0;
 }
 
-Mat correlate(Mat f, Mat w)
+Mat correlate(Mat f, Mat w, dip::BorderMode border)
 {
-	Mat output;
-	auto m = w.cols;
-	auto n = w.rows;
-	auto a = (m - 1) / 2;
-	auto b = (n - 1) / 2;
-	auto padSize = w.rows - 1;
-	Mat padded = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_8U);
-	Mat result = Mat::zeros(f.rows + 2 * padSize, f.cols + 2 * padSize, CV_8U);
-
-	//Pad is adding
-	auto roi = padded(Rect(w.cols - 1, w.rows - 1, f.rows, f.cols));
-	f.copyTo(roi);
-
-	//Start with some margin, because we padded the Mat
-	//Iterate all the points
-	for (auto y = padSize - 1; y < padded.rows - padSize + 1; ++y)
-	{
-		for (auto x = padSize - 1; x < padded.cols - padSize + 1; ++x)
-		{
-			//Get the Mat which consist of neighbours of the point
-			Mat neighbourhood = padded(Rect(x - a, y - b, w.cols, w.cols));
-
-			//Apply the filter
-			result.at<uchar>(y, x) = applyFilter(neighbourhood, w);
-		}
-	}
-
-	//Return unpadded Mat
-	return result(Rect(padSize, padSize, f.cols, f.rows));
+	return applyKernel(f, dip::Kernel<int>::correlation(w), border);
 }
 
-Mat convolute(Mat f, Mat w)
+Mat convolute(Mat f, Mat w, dip::BorderMode border)
 {
-	Mat convolutedW;
-	cv::rotate(w, convolutedW , RotateFlags::ROTATE_180);
+	//The kernel is rotated once while it is prepared
+	return applyKernel(f, dip::Kernel<int>::convolution(w), border);
+}
 
-	return correlate(f , convolutedW);
+Mat applyKernel(Mat f, const dip::Kernel<int>& w, dip::BorderMode border)
+{
+	//Equation : 3.4-1, the sum is clamped into the 8-bit range
+	return dip::correlate<uchar, int, uchar>(f, w, [](int result) {
+		return static_cast<uchar>(dip::stayInBoundaries(result, dip::Upper(255), dip::Lower(0)));
+	}, border);
 }
 
-uchar applyFilter(Mat f, Mat w)
+Mat applyDiskMask(Mat f, int diameter, dip::CorrelationMethod method, dip::BorderMode border)
 {
-	auto result = 0;
+	Mat w = Mat::zeros(diameter, diameter, CV_8U);
+	auto radius = (diameter - 1) / 2.0;
+	auto sum = 0;
 
-	//w(x,y) * f(x,y) = w(s,t) * f(x + s, y + t)  
-	for (auto y = 0; y < f.rows; ++y)
+	for (auto y = 0; y < diameter; ++y)
 	{
-		for (auto x = 0; x < f.cols; ++x)
+		for (auto x = 0; x < diameter; ++x)
 		{
-			result += w.at<uchar>(y, x) * f.at<uchar>(y, x);
+			if ((x - radius) * (x - radius) + (y - radius) * (y - radius) <= (radius + 0.5) * (radius + 0.5))
+			{
+				w.at<uchar>(y, x) = 1;
+				++sum;
+			}
 		}
 	}
 
-	return dip::stayInBoundaries(result , dip::Upper(255) , dip::Lower(0));
+	return dip::correlate<uchar, int, uchar>(f, w, [sum](int result) {
+		return static_cast<uchar>(result / sum);
+	}, method, border);
 }
 
 void printMat(Mat input)
@@ -156,4 +193,49 @@ void printMat(Mat input)
 
 		std::cout << std::endl;
 	}
-}
\ No newline at end of file
+}
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("spatial-correlation-convolution", largestSize);
+
+	Mat w = (Mat_<uchar>(3, 3) <<	1, 2, 3,
+									4, 5, 6,
+									7, 8, 9);
+	auto kernel = dip::Kernel<int>::correlation(w);
+
+	//A 31x31 disk as in applyDiskMask
+	const auto diameter = 31;
+	Mat disk = Mat::zeros(diameter, diameter, CV_32F);
+	auto radius = (diameter - 1) / 2.0;
+
+	for (auto y = 0; y < diameter; ++y)
+	{
+		for (auto x = 0; x < diameter; ++x)
+		{
+			if ((x - radius) * (x - radius) + (y - radius) * (y - radius) <= (radius + 0.5) * (radius + 0.5))
+				disk.at<float>(y, x) = 1;
+		}
+	}
+
+	disk /= sum(disk)[0];
+
+	auto filtered = [](const Mat& f, const Mat& kernel) {
+		Mat g;
+		filter2D(f, g, CV_8U, kernel, Point(-1, -1), 0, BORDER_CONSTANT);
+		return g;
+	};
+
+	Mat w32;
+	w.convertTo(w32, CV_32F);
+
+	benchmark.run("3x3 correlation", [&](const Mat& f) { return applyKernel(f, kernel, dip::BorderMode::Constant); },
+		[&](const Mat& f) { return filtered(f, w32); });
+	//31x31 direct sums take minutes on the larger images
+	benchmark.run("31x31 disk direct", [&](const Mat& f) { return applyDiskMask(f, diameter, dip::CorrelationMethod::Direct, dip::BorderMode::Constant); },
+		[&](const Mat& f) { return filtered(f, disk); }, 1024);
+	benchmark.run("31x31 disk fft", [&](const Mat& f) { return applyDiskMask(f, diameter, dip::CorrelationMethod::Fft, dip::BorderMode::Constant); },
+		[&](const Mat& f) { return filtered(f, disk); });
+
+	return 0;
+}
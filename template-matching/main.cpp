@@ -0,0 +1,150 @@
+/**
+ *
+ * Copyright (C) 2019
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file main.cpp
+ *
+ * @brief The program finds a template on an image by normalised cross-correlation
+ * Matching by correlation which is mentioned at Chapter 12.2.1 - Digital Image Processing (3rd Edition): Rafael C. Gonzalez
+ *
+ * @author Ozan Cansel
+ * Contact: ozancansel@gmail.com
+ * 
+ */
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/utility.hpp>
+#include "convolution.h"
+#include "matching.h"
+#include "benchmark.h"
+
+using namespace cv;
+
+//Measures the searches on synthetic images against cv::matchTemplate, see dip::Benchmark
+int benchmark(int largestSize);
+
+int main(int argc, char** argv) 
+{
+        const String keys = 
+	"{help h usage ?    || The program finds a template on an image by normalised cross-correlation.}"
+	"{input             | template-matching.jpg | an image which the template is searched on}"
+	"{template          |      | the template, a 64x64 patch is cropped from the middle of the input if it is not given}"
+	"{contrast          | 0.8  | the input is scaled by the contrast before the search, the score doesn't depend on it}"
+	"{brightness        | 20   | and shifted by the brightness}"
+	"{levels            | 2    | the image is searched 2^levels times smaller first, 0 is a full search}"
+	"{candidates        | 5    | number of the coarse placements which are refined}"
+	"{method            | auto | direct, fft or auto(chosen by the measured crossover)}"
+	"{bench             |      | measure the searches on synthetic images instead of showing them}"
+	"{benchLargest      | 16384 | size of the largest synthetic image}"
+    ;
+
+    CommandLineParser cmdParser(argc , argv, keys);
+
+    if (cmdParser.has("help"))
+    {
+        cmdParser.printMessage();
+        return 0;
+    }
+
+	if (cmdParser.has("bench"))
+		return benchmark(cmdParser.get<int>("benchLargest"));
+
+	Mat input = imread(cmdParser.get<cv::String>("input"), IMREAD_GRAYSCALE);
+
+	if (!input.data)
+	{
+		printf("No input data \n");
+		return -1;
+	}
+
+	Mat pattern;
+
+	if (cmdParser.has("template"))
+	{
+		pattern = imread(cmdParser.get<cv::String>("template"), IMREAD_GRAYSCALE);
+	}
+	else
+	{
+		auto size = std::min(64, std::min(input.rows, input.cols));
+		pattern = input(Rect((input.cols - size) / 2, (input.rows - size) / 2, size, size)).clone();
+	}
+
+	if (!pattern.data || pattern.rows > input.rows || pattern.cols > input.cols)
+	{
+		printf("The template must be an image which is not larger than the input \n");
+		return -1;
+	}
+
+	input.convertTo(input, -1, cmdParser.get<double>("contrast"), cmdParser.get<double>("brightness"));
+
+	auto levels = cmdParser.get<int>("levels");
+	auto candidates = cmdParser.get<int>("candidates");
+	auto method = dip::parseCorrelationMethod(cmdParser.get<cv::String>("method"));
+
+	auto start = getTickCount();
+	auto match = dip::matchTemplateCoarseToFine(input, pattern, levels, candidates, method);
+	auto elapsed = (getTickCount() - start) / getTickFrequency();
+
+	std::cout << "Template is found at " << match.location << " with the score " << match.score
+		<< " in " << elapsed * 1000 << " ms" << std::endl;
+
+	Mat found;
+	cvtColor(input, found, COLOR_GRAY2BGR);
+	rectangle(found, Rect(match.location, pattern.size()), Scalar(0, 0, 255), 2);
+
+	imshow("template", pattern);
+	imshow("Template Found", found);
+
+	waitKey(0);
+
+	return 0;
+}
+
+int benchmark(int largestSize)
+{
+	dip::Benchmark benchmark("template-matching", largestSize);
+
+	//A 64x64 patch of the synthetic pattern, which repeats all over the larger images
+	Mat pattern = dip::syntheticImage(256)(Rect(96, 96, 64, 64)).clone();
+
+	auto matched = [](const Mat& f, const Mat& t) {
+		Mat scores;
+		matchTemplate(f, t, scores, TM_CCOEFF_NORMED);
+		return scores;
+	};
+
+	//The scores of all placements, the correlation and the two integral images in CV_64F take 2 GB each for the largest image
+	benchmark.run("ncc full search", [&](const Mat& f) { return dip::matchTemplateNcc(f, pattern); },
+		[&](const Mat& f) { return matched(f, pattern); }, 4096);
+	//The output is the best placement, OpenCV searches the full resolution
+	benchmark.run("ncc coarse to fine", [&](const Mat& f) {
+		auto match = dip::matchTemplateCoarseToFine(f, pattern, 2, 5);
+		Mat best = (Mat_<double>(1, 3) << match.location.x, match.location.y, match.score);
+
+		return best;
+	}, [&](const Mat& f) {
+		auto scores = matched(f, pattern);
+		double score;
+		Point location;
+		minMaxLoc(scores, nullptr, &score, nullptr, &location);
+		Mat best = (Mat_<double>(1, 3) << location.x, location.y, score);
+
+		return best;
+	});
+
+	return 0;
+}
@@ -0,0 +1,365 @@
+#ifndef _FIXED_KERNEL_H
+#define _FIXED_KERNEL_H
+
+#include <array>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "convolution.h"
+
+namespace dip
+{
+/* A kernel whose size, coefficients(row major) and divisor are known at compile time.
+* Every tap is a constant for the compiler, so the loops are fully unrolled, zero taps are dropped
+* and a power of two divisor becomes a shift. 3x3, 5x5 and 7x7 kernels are supported.
+*/
+template <int K, int Divisor, int... Coefficients>
+struct FixedKernel
+{
+	static_assert(K == 3 || K == 5 || K == 7, "Fixed kernels are 3x3, 5x5 or 7x7");
+	static_assert(sizeof...(Coefficients) == K * K, "A fixed kernel needs K * K coefficients");
+	static_assert(Divisor > 0, "Divisor of a fixed kernel must be positive");
+
+	static const int size = K;
+	static const int divisor = Divisor;
+
+	static constexpr int coefficient(int i)
+	{
+		constexpr int coefficients[] = { Coefficients... };
+		return coefficients[i];
+	}
+};
+
+//The kernel rotated by 180 degrees, convolution with Kernel is correlation with RotatedKernel<Kernel>
+template <typename Kernel>
+struct RotatedKernel
+{
+	static const int size = Kernel::size;
+	static const int divisor = Kernel::divisor;
+
+	static constexpr int coefficient(int i)
+	{
+		return Kernel::coefficient(size * size - 1 - i);
+	}
+};
+
+/* Exact integer factors of a fixed kernel, Kernel = column * row when separable() holds.
+* row is the first non zero row of the kernel divided by the gcd of its taps, column holds the multiple of row at every row.
+*/
+template <typename Kernel>
+struct KernelFactors
+{
+	static const int size = Kernel::size;
+
+	static constexpr int first()
+	{
+		auto i = 0;
+
+		while (i < size * size - 1 && Kernel::coefficient(i) == 0)
+			++i;
+
+		return i;
+	}
+
+	static constexpr int gcd(int a, int b)
+	{
+		while (b != 0)
+		{
+			auto r = a % b;
+			a = b;
+			b = r;
+		}
+
+		return a < 0 ? -a : a;
+	}
+
+	static constexpr int divisor()
+	{
+		auto result = 0;
+
+		for (auto s = 0; s < size; ++s)
+		{
+			result = gcd(Kernel::coefficient(first() / size * size + s), result);
+		}
+
+		return result == 0 ? 1 : result;
+	}
+
+	static constexpr int row(int s)
+	{
+		return Kernel::coefficient(first() / size * size + s) / divisor();
+	}
+
+	static constexpr int column(int t)
+	{
+		return row(first() % size) == 0 ? 0 : Kernel::coefficient(t * size + first() % size) / row(first() % size);
+	}
+
+	static constexpr bool separable()
+	{
+		for (auto t = 0; t < size; ++t)
+		{
+			for (auto s = 0; s < size; ++s)
+			{
+				if (column(t) * row(s) != Kernel::coefficient(t * size + s))
+					return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+//Mask in the Figure 3.32a
+typedef FixedKernel<3, 9,
+	1, 1, 1,
+	1, 1, 1,
+	1, 1, 1> BoxKernel;
+
+//Mask in the Figure 3.32b
+typedef FixedKernel<3, 16,
+	1, 2, 1,
+	2, 4, 2,
+	1, 2, 1> WeightedAverageKernel;
+
+//Figure: 3.37b
+typedef FixedKernel<3, 1,
+	-1, -1, -1,
+	-1,  8, -1,
+	-1, -1, -1> LaplacianKernel;
+
+//Equation: 3.6-16
+typedef FixedKernel<3, 1,
+	-1, -2, -1,
+	 0,  0,  0,
+	 1,  2,  1> SobelXKernel;
+
+//Equation: 3.6-17
+typedef FixedKernel<3, 1,
+	-1, 0, 1,
+	-2, 0, 2,
+	-1, 0, 1> SobelYKernel;
+
+//Multiplies a neighbour with a constant coefficient, zero and unit coefficients don't cost a multiplication
+template <int Coefficient>
+struct Tap
+{
+	template <typename TAcc, typename TIn>
+	static void add(TAcc& result, TIn value) { result += TAcc(Coefficient) * value; }
+};
+
+template <>
+struct Tap<0>
+{
+	template <typename TAcc, typename TIn>
+	static void add(TAcc&, TIn) {}
+};
+
+template <>
+struct Tap<1>
+{
+	template <typename TAcc, typename TIn>
+	static void add(TAcc& result, TIn value) { result += value; }
+};
+
+template <>
+struct Tap<-1>
+{
+	template <typename TAcc, typename TIn>
+	static void add(TAcc& result, TIn value) { result -= value; }
+};
+
+template <int Value>
+struct IsPowerOfTwo : std::integral_constant<bool, (Value > 0) && (Value & (Value - 1)) == 0> {};
+
+template <int Value>
+struct Log2 : std::integral_constant<int, 1 + Log2<Value / 2>::value> {};
+
+template <>
+struct Log2<1> : std::integral_constant<int, 0> {};
+
+//Integer sums of a power of two divisor are shifted, every kernel of ours divides non negative sums only
+template <int Divisor, typename TAcc>
+TAcc divide(TAcc result, std::true_type)
+{
+	return result >> Log2<Divisor>::value;
+}
+
+template <int Divisor, typename TAcc>
+TAcc divide(TAcc result, std::false_type)
+{
+	return Divisor == 1 ? result : result / TAcc(Divisor);
+}
+
+template <typename Kernel, typename TAcc>
+TAcc normalise(TAcc result)
+{
+	return divide<Kernel::divisor>(result, std::integral_constant<bool, std::is_integral<TAcc>::value && IsPowerOfTwo<Kernel::divisor>::value && Kernel::divisor != 1>());
+}
+
+//Sum of all taps at column x of the rows, the taps are expanded at compile time
+template <typename Kernel, typename TAcc, typename TIn, std::size_t... Taps>
+TAcc applyFixedKernel(const TIn* const* rows, int x, std::index_sequence<Taps...>)
+{
+	auto result = TAcc(0);
+	int expand[] = { 0, (Tap<Kernel::coefficient(Taps)>::add(result, rows[Taps / Kernel::size][x + Taps % Kernel::size]), 0)... };
+	(void)expand;
+
+	return result;
+}
+
+//Response of a fixed kernel to a neighbourhood which is already loaded into values(row major)
+template <typename Kernel, typename TAcc, std::size_t... Taps>
+TAcc applyToNeighbourhood(const TAcc* values, std::index_sequence<Taps...>)
+{
+	auto result = TAcc(0);
+	int expand[] = { 0, (Tap<Kernel::coefficient(Taps)>::add(result, values[Taps]), 0)... };
+	(void)expand;
+
+	return result;
+}
+
+template <int Size, typename... Kernels>
+constexpr bool haveSize()
+{
+	bool sizes[] = { true, (Kernels::size == Size)... };
+
+	for (auto same : sizes)
+	{
+		if (!same)
+			return false;
+	}
+
+	return true;
+}
+
+//Horizontal and vertical passes of a separable fixed kernel, the taps are the factors of KernelFactors
+template <typename Kernel, typename TAcc, typename TIn, std::size_t... Taps>
+TAcc applyRowFactor(const TIn* row, int x, std::index_sequence<Taps...>)
+{
+	auto result = TAcc(0);
+	int expand[] = { 0, (Tap<KernelFactors<Kernel>::row(Taps)>::add(result, row[x + Taps]), 0)... };
+	(void)expand;
+
+	return result;
+}
+
+template <typename Kernel, typename TAcc, std::size_t... Taps>
+TAcc applyColumnFactor(const TAcc* const* sums, int x, std::index_sequence<Taps...>)
+{
+	auto result = TAcc(0);
+	int expand[] = { 0, (Tap<KernelFactors<Kernel>::column(Taps)>::add(result, sums[Taps][x]), 0)... };
+	(void)expand;
+
+	return result;
+}
+
+//Coefficients of the kernel as a Mat of the given type, e.g. to print it
+template <typename Kernel>
+cv::Mat kernelMat(int type)
+{
+	cv::Mat w(Kernel::size, Kernel::size, CV_32S);
+
+	for (auto i = 0; i < Kernel::size * Kernel::size; ++i)
+	{
+		w.at<int>(i / Kernel::size, i % Kernel::size) = Kernel::coefficient(i);
+	}
+
+	w.convertTo(w, type);
+
+	return w;
+}
+
+//Separable kernels are filtered in two 1D passes
+template <typename Kernel, typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlateFixed(const cv::Mat& f, Store store, BorderMode border, std::true_type)
+{
+	const auto K = Kernel::size;
+
+	auto rowPass = [](const TIn* row, int x) {
+		return applyRowFactor<Kernel, TAcc>(row, x, std::make_index_sequence<Kernel::size>());
+	};
+
+	auto columnPass = [](const TAcc* const* sums, int x) {
+		return applyColumnFactor<Kernel, TAcc>(sums, x, std::make_index_sequence<Kernel::size>());
+	};
+
+	return separableFilter<TIn, TAcc, TOut>(f, K, K, border, rowPass, columnPass, [&store](TAcc result) {
+		return store(normalise<Kernel>(result));
+	});
+}
+
+template <typename Kernel, typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlateFixed(const cv::Mat& f, Store store, BorderMode border, std::false_type)
+{
+	const auto K = Kernel::size;
+
+	cv::Mat g(f.rows, f.cols, cv::DataType<TOut>::type);
+
+	filterRows<TIn, TOut>(f, g, K, K, border, [&store](const TIn* const* rows, TOut* output, int count) {
+		for (auto x = 0; x < count; ++x)
+		{
+			auto result = applyFixedKernel<Kernel, TAcc>(rows, x, std::make_index_sequence<Kernel::size * Kernel::size>());
+			output[x] = store(normalise<Kernel>(result));
+		}
+	});
+
+	return g;
+}
+
+/* Correlation with a fixed kernel, Equation : 3.4-1.
+* The sum of every pixel is divided by the divisor of the kernel and converted by store.
+* Rank 1 kernels are detected at compile time and filtered in two passes, e.g. the box mask costs two 3 tap passes per pixel instead of 9 taps.
+*/
+template <typename Kernel, typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlate(const cv::Mat& f, Store store, BorderMode border = BorderMode::Constant)
+{
+	return correlateFixed<Kernel, TIn, TAcc, TOut>(f, store, border, std::integral_constant<bool, KernelFactors<Kernel>::separable()>());
+}
+
+template <typename Kernel, typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat convolve(const cv::Mat& f, Store store, BorderMode border = BorderMode::Constant)
+{
+	return correlate<RotatedKernel<Kernel>, TIn, TAcc, TOut>(f, store, border);
+}
+
+/* Correlates f with all of the Kernels in a single pass, e.g. Gx, Gy and the Laplacian of an edge pipeline.
+* Every neighbourhood is loaded once and all of the kernels are applied to it, instead of a sweep over f per kernel.
+* emit(y, x, responses) gets the normalised responses of the pixel in the order of Kernels, so it can write them
+* or the values derived from them(e.g. the gradient magnitude) into as many outputs as needed.
+*/
+template <typename TIn, typename TAcc, typename... Kernels, typename Emit>
+void correlateFused(const cv::Mat& f, BorderMode border, Emit emit)
+{
+	typedef typename std::tuple_element<0, std::tuple<Kernels...>>::type First;
+	static_assert(haveSize<First::size, Kernels...>(), "Fused kernels must have the same size");
+
+	const auto K = First::size;
+
+	scanRows<TIn>(f, K, K, border, [&emit](const TIn* const* rows, int y, int begin, int count) {
+		TAcc values[First::size * First::size];
+
+		for (auto x = 0; x < count; ++x)
+		{
+			for (auto t = 0; t < First::size; ++t)
+			{
+				for (auto s = 0; s < First::size; ++s)
+				{
+					values[t * First::size + s] = rows[t][x + s];
+				}
+			}
+
+			std::array<TAcc, sizeof...(Kernels)> responses = { {
+				normalise<Kernels>(applyToNeighbourhood<Kernels>(values, std::make_index_sequence<First::size * First::size>()))...
+			} };
+
+			emit(y, begin + x, responses);
+		}
+	});
+}
+
+}
+
+#endif
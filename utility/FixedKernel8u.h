@@ -0,0 +1,401 @@
+#ifndef _FIXED_KERNEL_8U_H
+#define _FIXED_KERNEL_8U_H
+
+#include <algorithm>
+#include "FixedKernel.h"
+#include "simd.h"
+
+namespace dip
+{
+//Whether the 8-bit neighbourhood sums of a fixed kernel fit into 16-bit lanes and can be divided by a fixed-point multiply-shift
+template <typename Kernel>
+struct Kernel8u
+{
+	static constexpr bool nonNegative()
+	{
+		for (auto i = 0; i < Kernel::size * Kernel::size; ++i)
+		{
+			if (Kernel::coefficient(i) < 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	//Largest sum of an 8-bit neighbourhood
+	static constexpr long long maxSum()
+	{
+		auto result = 0LL;
+
+		for (auto i = 0; i < Kernel::size * Kernel::size; ++i)
+		{
+			result += Kernel::coefficient(i) * 255LL;
+		}
+
+		return result;
+	}
+
+	//sum / divisor = (sum * reciprocal) >> 16
+	static constexpr long long reciprocal()
+	{
+		return (65536 + Kernel::divisor - 1) / Kernel::divisor;
+	}
+
+	//The rounding error of the reciprocal stays below one for every sum up to maxSum
+	static constexpr bool exactReciprocal()
+	{
+		return IsPowerOfTwo<Kernel::divisor>::value || maxSum() * (reciprocal() * Kernel::divisor - 65536) < 65536;
+	}
+
+	static constexpr bool vectorizable()
+	{
+		return Kernel::size == 3 && nonNegative() && maxSum() <= 65535 && exactReciprocal();
+	}
+
+	//Largest magnitude of the sum of an 8-bit neighbourhood, the signed sums fit into 16-bit lanes below 32768
+	static constexpr long long maxMagnitude()
+	{
+		auto positive = 0LL;
+		auto negative = 0LL;
+
+		for (auto i = 0; i < Kernel::size * Kernel::size; ++i)
+		{
+			(Kernel::coefficient(i) < 0 ? negative : positive) += Kernel::coefficient(i) * 255LL;
+		}
+
+		return positive > -negative ? positive : -negative;
+	}
+
+	static constexpr bool vectorizable16s()
+	{
+		return Kernel::size == 3 && Kernel::divisor == 1 && maxMagnitude() <= 32767;
+	}
+};
+
+#if DIP_SSE2
+//Multiplies the widened pixels with a constant coefficient and adds them with saturation
+template <int Coefficient>
+struct SimdTap
+{
+	template <typename Isa>
+	static void add(typename Isa::Vector& sum, typename Isa::Vector value)
+	{
+		sum = Isa::addSaturate16(sum, Isa::multiply16(value, Isa::set16(Coefficient)));
+	}
+};
+
+template <>
+struct SimdTap<0>
+{
+	template <typename Isa>
+	static void add(typename Isa::Vector&, typename Isa::Vector) {}
+};
+
+template <>
+struct SimdTap<1>
+{
+	template <typename Isa>
+	static void add(typename Isa::Vector& sum, typename Isa::Vector value)
+	{
+		sum = Isa::addSaturate16(sum, value);
+	}
+};
+
+template <typename Isa, int Coefficient>
+void accumulate8u(const uchar* pixels, typename Isa::Vector& low, typename Isa::Vector& high)
+{
+	if (Coefficient == 0)
+		return;
+
+	auto value = Isa::load(pixels);
+
+	SimdTap<Coefficient>::template add<Isa>(low, Isa::widenLow(value));
+	SimdTap<Coefficient>::template add<Isa>(high, Isa::widenHigh(value));
+}
+
+//Multiplies the widened pixels with a signed coefficient and adds them without saturation
+template <int Coefficient>
+struct SignedTap
+{
+	template <typename Isa>
+	static void add(typename Isa::Vector& sum, typename Isa::Vector value)
+	{
+		sum = Isa::add16(sum, Isa::multiply16(value, Isa::set16(Coefficient)));
+	}
+};
+
+template <>
+struct SignedTap<0>
+{
+	template <typename Isa>
+	static void add(typename Isa::Vector&, typename Isa::Vector) {}
+};
+
+template <>
+struct SignedTap<1>
+{
+	template <typename Isa>
+	static void add(typename Isa::Vector& sum, typename Isa::Vector value)
+	{
+		sum = Isa::add16(sum, value);
+	}
+};
+
+template <>
+struct SignedTap<-1>
+{
+	template <typename Isa>
+	static void add(typename Isa::Vector& sum, typename Isa::Vector value)
+	{
+		sum = Isa::subtract16(sum, value);
+	}
+};
+
+template <typename Isa, int Coefficient>
+void accumulate16s(const uchar* pixels, typename Isa::Vector& low, typename Isa::Vector& high)
+{
+	if (Coefficient == 0)
+		return;
+
+	auto value = Isa::load(pixels);
+
+	SignedTap<Coefficient>::template add<Isa>(low, Isa::widenLow(value));
+	SignedTap<Coefficient>::template add<Isa>(high, Isa::widenHigh(value));
+}
+
+//The signed sums of Isa::Width neighbourhoods starting from x in the low and the high 16-bit lanes
+template <typename Kernel, typename Isa, std::size_t... Taps>
+void sumNeighbourhoods16s(const uchar* const* rows, int x, typename Isa::Vector& low, typename Isa::Vector& high, std::index_sequence<Taps...>)
+{
+	low = Isa::zero();
+	high = Isa::zero();
+
+	int expand[] = { 0, (accumulate16s<Isa, Kernel::coefficient(Taps)>(rows[Taps / 3] + x + Taps % 3, low, high), 0)... };
+	(void)expand;
+}
+
+//Adds the widened pixels to the signed sums of three kernels, the pixels are loaded and widened once for all of them
+template <typename Isa, int Coefficient0, int Coefficient1, int Coefficient2>
+void accumulateFused16s(const uchar* pixels, typename Isa::Vector* low, typename Isa::Vector* high)
+{
+	auto value = Isa::load(pixels);
+	auto valueLow = Isa::widenLow(value);
+	auto valueHigh = Isa::widenHigh(value);
+
+	SignedTap<Coefficient0>::template add<Isa>(low[0], valueLow);
+	SignedTap<Coefficient0>::template add<Isa>(high[0], valueHigh);
+	SignedTap<Coefficient1>::template add<Isa>(low[1], valueLow);
+	SignedTap<Coefficient1>::template add<Isa>(high[1], valueHigh);
+	SignedTap<Coefficient2>::template add<Isa>(low[2], valueLow);
+	SignedTap<Coefficient2>::template add<Isa>(high[2], valueHigh);
+}
+
+//The signed sums of three kernels of Isa::Width neighbourhoods starting from x, see sumNeighbourhoods16s
+template <typename Kernel0, typename Kernel1, typename Kernel2, typename Isa, std::size_t... Taps>
+void sumFusedNeighbourhoods16s(const uchar* const* rows, int x, typename Isa::Vector* low, typename Isa::Vector* high, std::index_sequence<Taps...>)
+{
+	for (auto i = 0; i < 3; ++i)
+	{
+		low[i] = Isa::zero();
+		high[i] = Isa::zero();
+	}
+
+	int expand[] = { 0, (accumulateFused16s<Isa, Kernel0::coefficient(Taps), Kernel1::coefficient(Taps), Kernel2::coefficient(Taps)>(rows[Taps / 3] + x + Taps % 3, low, high), 0)... };
+	(void)expand;
+}
+
+//|v| of the signed 16-bit lanes
+template <typename Isa>
+typename Isa::Vector absolute16(typename Isa::Vector v)
+{
+	return Isa::max16(v, Isa::subtract16(Isa::zero(), v));
+}
+
+//|gx| + |gy| of Isa::Width pixels starting from x, saturated to 0..255
+template <typename GxKernel, typename GyKernel, typename Isa>
+void gradientRow8u(const uchar* const* rows, uchar* output, int cols, int& x)
+{
+	for (; x + Isa::Width <= cols; x += Isa::Width)
+	{
+		typename Isa::Vector gxLow, gxHigh, gyLow, gyHigh;
+
+		sumNeighbourhoods16s<GxKernel, Isa>(rows, x, gxLow, gxHigh, std::make_index_sequence<9>());
+		sumNeighbourhoods16s<GyKernel, Isa>(rows, x, gyLow, gyHigh, std::make_index_sequence<9>());
+
+		auto low = Isa::add16(absolute16<Isa>(gxLow), absolute16<Isa>(gyLow));
+		auto high = Isa::add16(absolute16<Isa>(gxHigh), absolute16<Isa>(gyHigh));
+
+		Isa::store(output + x, Isa::narrow(low, high));
+	}
+}
+
+//The sums of Kernel and the |gx| + |gy| of Isa::Width pixels starting from x, see correlateGradient8u
+template <typename Kernel, typename GxKernel, typename GyKernel, typename Isa>
+void correlateGradientRow8u(const uchar* const* rows, short* responses, uchar* gradient, int cols, int& x)
+{
+	for (; x + Isa::Width <= cols; x += Isa::Width)
+	{
+		typename Isa::Vector low[3], high[3];
+
+		sumFusedNeighbourhoods16s<Kernel, GxKernel, GyKernel, Isa>(rows, x, low, high, std::make_index_sequence<9>());
+		Isa::store16(responses + x, low[0], high[0]);
+
+		auto gradientLow = Isa::add16(absolute16<Isa>(low[1]), absolute16<Isa>(low[2]));
+		auto gradientHigh = Isa::add16(absolute16<Isa>(high[1]), absolute16<Isa>(high[2]));
+
+		Isa::store(gradient + x, Isa::narrow(gradientLow, gradientHigh));
+	}
+}
+
+template <typename Kernel, typename Isa>
+typename Isa::Vector normalise8u(typename Isa::Vector sum)
+{
+	if (Kernel::divisor == 1)
+		return sum;
+
+	if (IsPowerOfTwo<Kernel::divisor>::value)
+		return Isa::template shiftRight16<Log2<Kernel::divisor>::value>(sum);
+
+	return Isa::multiplyHigh16(sum, Isa::set16(static_cast<short>(Kernel8u<Kernel>::reciprocal())));
+}
+
+//Filters Isa::Width pixels of a row at a time starting from x, x is left at the first pixel which is not filtered
+template <typename Kernel, typename Isa, std::size_t... Taps>
+void correlateRow8u(const uchar* const* rows, uchar* output, int cols, int& x, std::index_sequence<Taps...>)
+{
+	for (; x + Isa::Width <= cols; x += Isa::Width)
+	{
+		auto low = Isa::zero();
+		auto high = Isa::zero();
+
+		int expand[] = { 0, (accumulate8u<Isa, Kernel::coefficient(Taps)>(rows[Taps / 3] + x + Taps % 3, low, high), 0)... };
+		(void)expand;
+
+		Isa::store(output + x, Isa::narrow(normalise8u<Kernel, Isa>(low), normalise8u<Kernel, Isa>(high)));
+	}
+}
+#endif
+
+template <typename Kernel>
+cv::Mat correlate8u(const cv::Mat& f, BorderMode border, std::false_type)
+{
+	return correlate<Kernel, uchar, int, uchar>(f, [](int result) {
+		return static_cast<uchar>(std::min(std::max(result, 0), 255));
+	}, border);
+}
+
+template <typename Kernel>
+cv::Mat correlate8u(const cv::Mat& f, BorderMode border, std::true_type)
+{
+	cv::Mat g(f.rows, f.cols, CV_8U);
+
+	filterRows<uchar, uchar>(f, g, 3, 3, border, [](const uchar* const* rows, uchar* output, int count) {
+		auto x = 0;
+
+#if DIP_AVX2
+		correlateRow8u<Kernel, Avx2>(rows, output, count, x, std::make_index_sequence<9>());
+#endif
+#if DIP_SSE2
+		correlateRow8u<Kernel, Sse2>(rows, output, count, x, std::make_index_sequence<9>());
+#endif
+
+		for (; x < count; ++x)
+		{
+			auto result = normalise<Kernel>(applyFixedKernel<Kernel, int>(rows, x, std::make_index_sequence<9>()));
+			output[x] = static_cast<uchar>(std::min(result, 255));
+		}
+	});
+
+	return g;
+}
+
+/* Correlation of an 8-bit image with a 3x3 fixed kernel of non negative coefficients, e.g. the smoothing masks.
+* The neighbourhood sums are accumulated in 16-bit lanes with saturation, 16(SSE2) or 32(AVX2) pixels at a time,
+* and divided by a fixed-point multiply-shift instead of a division: sum / divisor = (sum * ceil(2^16 / divisor)) >> 16,
+* which is exact for every sum the kernel can produce. The outputs are saturated to 0..255.
+* Other kernels, or targets without SSE2, use the scalar path with the same results.
+*/
+template <typename Kernel>
+cv::Mat correlate8u(const cv::Mat& f, BorderMode border = BorderMode::Constant)
+{
+	CV_Assert(f.type() == CV_8U);
+
+	return correlate8u<Kernel>(f, border, std::integral_constant<bool, Kernel8u<Kernel>::vectorizable()>());
+}
+
+/* Gradient magnitude of Equation 3.6-20, |gx| + |gy| saturated to 0..255, of an 8-bit image in a single pass.
+* Both of the signed sums of a pixel are accumulated in 16-bit lanes, 16(SSE2) or 32(AVX2) pixels at a time.
+*/
+template <typename GxKernel, typename GyKernel>
+cv::Mat gradient8u(const cv::Mat& f, BorderMode border = BorderMode::Constant)
+{
+	static_assert(Kernel8u<GxKernel>::vectorizable16s() && Kernel8u<GyKernel>::vectorizable16s(), "The gradient kernels must be 3x3 kernels of 16-bit sums");
+	CV_Assert(f.type() == CV_8U);
+
+	cv::Mat g(f.rows, f.cols, CV_8U);
+
+	filterRows<uchar, uchar>(f, g, 3, 3, border, [](const uchar* const* rows, uchar* output, int count) {
+		auto x = 0;
+
+#if DIP_AVX2
+		gradientRow8u<GxKernel, GyKernel, Avx2>(rows, output, count, x);
+#endif
+#if DIP_SSE2
+		gradientRow8u<GxKernel, GyKernel, Sse2>(rows, output, count, x);
+#endif
+
+		for (; x < count; ++x)
+		{
+			auto gx = applyFixedKernel<GxKernel, int>(rows, x, std::make_index_sequence<9>());
+			auto gy = applyFixedKernel<GyKernel, int>(rows, x, std::make_index_sequence<9>());
+
+			output[x] = static_cast<uchar>(std::min(std::abs(gx) + std::abs(gy), 255));
+		}
+	});
+
+	return g;
+}
+
+/* The signed 16-bit sums of Kernel and gradient8u with GxKernel and GyKernel in a single pass, e.g. the Laplacian and the gradient of
+* the sharpening. Every neighbourhood is loaded and widened once for the three kernels, 16(SSE2) or 32(AVX2) pixels at a time.
+* row(y, begin, count) is called after the outputs begin .. begin + count - 1 of the row y are written,
+* so a caller can gather statistics of them while they are still in the cache.
+*/
+template <typename Kernel, typename GxKernel, typename GyKernel, typename Row>
+void correlateGradient8u(const cv::Mat& f, cv::Mat& responses, cv::Mat& gradient, Row row, BorderMode border = BorderMode::Constant)
+{
+	static_assert(Kernel8u<Kernel>::vectorizable16s() && Kernel8u<GxKernel>::vectorizable16s() && Kernel8u<GyKernel>::vectorizable16s(),
+		"The kernels must be 3x3 kernels of 16-bit sums");
+	CV_Assert(f.type() == CV_8U);
+
+	responses.create(f.rows, f.cols, CV_16S);
+	gradient.create(f.rows, f.cols, CV_8U);
+
+	scanRows<uchar>(f, 3, 3, border, [&](const uchar* const* rows, int y, int begin, int count) {
+		auto responseOutput = responses.ptr<short>(y) + begin;
+		auto gradientOutput = gradient.ptr<uchar>(y) + begin;
+		auto x = 0;
+
+#if DIP_AVX2
+		correlateGradientRow8u<Kernel, GxKernel, GyKernel, Avx2>(rows, responseOutput, gradientOutput, count, x);
+#endif
+#if DIP_SSE2
+		correlateGradientRow8u<Kernel, GxKernel, GyKernel, Sse2>(rows, responseOutput, gradientOutput, count, x);
+#endif
+
+		for (; x < count; ++x)
+		{
+			auto gx = applyFixedKernel<GxKernel, int>(rows, x, std::make_index_sequence<9>());
+			auto gy = applyFixedKernel<GyKernel, int>(rows, x, std::make_index_sequence<9>());
+
+			responseOutput[x] = static_cast<short>(applyFixedKernel<Kernel, int>(rows, x, std::make_index_sequence<9>()));
+			gradientOutput[x] = static_cast<uchar>(std::min(std::abs(gx) + std::abs(gy), 255));
+		}
+
+		row(y, begin, count);
+	});
+}
+
+}
+
+#endif
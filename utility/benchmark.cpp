@@ -0,0 +1,150 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace dip
+{
+	namespace
+	{
+		//A run is repeated until the runs take this long, so the small images are not measured by the resolution of the clock
+		const double MinimumSeconds = 0.25;
+
+		//Mean seconds of a run, output is the output of the last run
+		double measure(const Benchmark::Algorithm& algorithm, const cv::Mat& input, cv::Mat& output)
+		{
+			auto runs = 0;
+			auto start = cv::getTickCount();
+			auto elapsed = .0;
+
+			do
+			{
+				output = algorithm(input);
+				++runs;
+				elapsed = (cv::getTickCount() - start) / cv::getTickFrequency();
+			} while (elapsed < MinimumSeconds);
+
+			return elapsed / runs;
+		}
+
+		std::string formatSize(int size)
+		{
+			return std::to_string(size) + "x" + std::to_string(size);
+		}
+	}
+
+	cv::Mat syntheticImage(int size)
+	{
+		cv::Mat f(size, size, CV_8U);
+
+		//The waves are separable, a row and a column of them are computed once
+		const auto pi = 3.14159265358979;
+		std::vector<double> rowWave(size);
+		std::vector<double> columnWave(size);
+
+		for (auto i = 0; i < size; ++i)
+		{
+			rowWave[i] = std::cos(2 * pi * i / 131);
+			columnWave[i] = std::sin(2 * pi * i / 97);
+		}
+
+		cv::parallel_for_(cv::Range(0, size), [&](const cv::Range& range) {
+			for (auto y = range.start; y < range.end; ++y)
+			{
+				auto row = f.ptr<uchar>(y);
+
+				for (auto x = 0; x < size; ++x)
+				{
+					//A disc of radius 24 in every other cell of 64 x 64
+					auto dx = x % 64 - 32;
+					auto dy = y % 64 - 32;
+					auto disc = ((x / 64 + y / 64) % 2 == 0 && dx * dx + dy * dy < 24 * 24) ? 60 : 0;
+
+					auto hash = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u;
+					auto noise = static_cast<int>((hash * 2654435761u) >> 28) - 8;
+
+					auto value = 100 + 50 * columnWave[x] * rowWave[y] + disc + noise;
+					row[x] = cv::saturate_cast<uchar>(value);
+				}
+			}
+		});
+
+		return f;
+	}
+
+	Benchmark::Benchmark(const std::string& program, int largestSize)
+		: program_(program), largestSize_(largestSize), threads_(std::max(1, cv::getNumThreads()))
+	{
+		std::cout << program_ << " on synthetic images up to " << formatSize(largestSize_) << ", " << threads_ << " threads" << std::endl;
+		std::cout << std::left << std::setw(28) << "algorithm" << std::setw(12) << "size" << std::right
+			<< std::setw(8) << "threads" << std::setw(12) << "ms" << std::setw(12) << "Mpixel/s" << std::setw(10) << "GB/s"
+			<< std::setw(10) << "scaling" << std::setw(12) << "vs OpenCV" << std::endl;
+	}
+
+	void Benchmark::run(const std::string& name, Algorithm algorithm, Algorithm reference, int largestSize)
+	{
+		auto largest = std::min(largestSize, largestSize_);
+
+		for (auto size = 256; size <= largest; size *= 4)
+		{
+			auto input = syntheticImage(size);
+			auto singleThreaded = .0;
+			std::vector<int> counts;
+
+			//1, 2, 4 .. threads
+			for (auto threads = 1; threads < threads_; threads *= 2)
+			{
+				counts.push_back(threads);
+			}
+
+			counts.push_back(threads_);
+
+			for (auto threads : counts)
+			{
+				cv::setNumThreads(threads);
+
+				cv::Mat output;
+				auto seconds = measure(algorithm, input, output);
+
+				if (threads == 1)
+					singleThreaded = seconds;
+
+				auto pixels = static_cast<double>(input.total());
+				auto bytes = static_cast<double>(input.total() * input.elemSize() + output.total() * output.elemSize());
+
+				std::ostringstream speedUp;
+				speedUp << std::fixed << std::setprecision(2);
+
+				if (reference)
+				{
+					cv::Mat expected;
+					speedUp << measure(reference, input, expected) / seconds << "x";
+				}
+				else
+				{
+					speedUp << "-";
+				}
+
+				std::ostringstream scaling;
+				scaling << std::fixed << std::setprecision(2) << singleThreaded / seconds << "x";
+
+				std::cout << std::left << std::setw(28) << name << std::setw(12) << formatSize(size) << std::right << std::fixed
+					<< std::setw(8) << threads
+					<< std::setw(12) << std::setprecision(3) << seconds * 1000
+					<< std::setw(12) << std::setprecision(1) << pixels / seconds / 1e6
+					<< std::setw(10) << std::setprecision(2) << bytes / seconds / 1e9
+					<< std::setw(10) << scaling.str()
+					<< std::setw(12) << speedUp.str() << std::endl;
+			}
+		}
+
+		cv::setNumThreads(threads_);
+
+		if (largest < largestSize_)
+			std::cout << name << " is not measured above " << formatSize(largest) << std::endl;
+	}
+}
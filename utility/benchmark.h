@@ -0,0 +1,40 @@
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <functional>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+namespace dip
+{
+/* 8-bit size x size test image of smooth waves, the edges of a checkerboard of discs and noise,
+* so neither a flat nor a random image favours a filter. The image of a size is the same in every run.
+*/
+cv::Mat syntheticImage(int size);
+
+/* Measures the throughput of the algorithms of a program, e.g. in the --bench mode of the programs.
+* Every algorithm runs on the synthetic images of 256^2, 1024^2, 4096^2 and 16384^2 pixels up to the largest size,
+* with 1, 2, 4 .. cv::getNumThreads() threads. A line is printed for every run:
+* - the time of a run, the mean of the runs repeated for a quarter of a second at least
+* - pixels/s of the input and GB/s of the bytes of the input and the output, the bytes an algorithm can't avoid moving
+* - the speed-up over a single thread
+* - the speed-up over the OpenCV function which computes the equivalent output, with the same number of threads
+*/
+class Benchmark
+{
+public:
+	typedef std::function<cv::Mat(const cv::Mat&)> Algorithm;
+
+	Benchmark(const std::string& program, int largestSize);
+
+	//largestSize limits the sizes of the algorithms whose large images take minutes or don't fit into the memory
+	void run(const std::string& name, Algorithm algorithm, Algorithm reference = Algorithm(), int largestSize = 16384);
+
+private:
+	std::string program_;
+	int largestSize_;
+	int threads_;
+};
+}
+
+#endif
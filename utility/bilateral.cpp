@@ -0,0 +1,211 @@
+#include "bilateral.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace dip
+{
+	namespace
+	{
+		//The blur kernel reaches 2 cells, the grid has that many empty cells around the data
+		const auto padding = 2;
+
+		//The largest grid, 8 GB of its two channels
+		const auto maxCells = std::size_t(1) << 30;
+
+		//Adjacent lines of an axis blurred together, the cells of a position along the axis are contiguous in them
+		const auto blurBlock = 64;
+
+		//Sums of the pixels and the number of them in every cell
+		class BilateralGrid
+		{
+		public:
+			BilateralGrid(int width, int height, int depth)
+				: width_(width),
+				  height_(height),
+				  depth_(depth),
+				  values_(cells(), 0.0f),
+				  weights_(cells(), 0.0f)
+			{
+			}
+
+			std::size_t cells() const
+			{
+				return static_cast<std::size_t>(width_) * height_ * depth_;
+			}
+
+			std::size_t index(int x, int y, int z) const
+			{
+				return (static_cast<std::size_t>(z) * height_ + y) * width_ + x;
+			}
+
+			void splat(int x, int y, int z, float value)
+			{
+				auto i = index(x, y, z);
+				values_[i] += value;
+				weights_[i] += 1.0f;
+			}
+
+			//Blurs both of the channels along an axis whose neighbouring cells are stride apart
+			void blur(std::size_t stride, int length)
+			{
+				blur(values_, stride, length);
+				blur(weights_, stride, length);
+			}
+
+			//The channels interpolated at a position within the grid
+			void slice(float x, float y, float z, float& value, float& weight) const
+			{
+				auto x0 = static_cast<int>(x);
+				auto y0 = static_cast<int>(y);
+				auto z0 = static_cast<int>(z);
+				auto dx = x - x0;
+				auto dy = y - y0;
+				auto dz = z - z0;
+
+				value = 0.0f;
+				weight = 0.0f;
+
+				for (auto k = 0; k < 2; ++k)
+				{
+					for (auto j = 0; j < 2; ++j)
+					{
+						for (auto i = 0; i < 2; ++i)
+						{
+							auto factor = (i ? dx : 1 - dx) * (j ? dy : 1 - dy) * (k ? dz : 1 - dz);
+							auto cell = index(x0 + i, y0 + j, z0 + k);
+
+							value += factor * values_[cell];
+							weight += factor * weights_[cell];
+						}
+					}
+				}
+			}
+
+			int width() const { return width_; }
+			int height() const { return height_; }
+			int depth() const { return depth_; }
+
+		private:
+			/* The lines of the axis are blurred in place through a buffer of a block of them, in parallel.
+			* Line k starts at cell (k / stride) * stride * length + k % stride, so the lines k of the same k / stride are
+			* adjacent and a block of them is copied and written by the contiguous runs of every position along the axis.
+			*/
+			void blur(std::vector<float>& channel, std::size_t stride, int length)
+			{
+				auto lines = cells() / length;
+				auto blocks = (lines + blurBlock - 1) / blurBlock;
+
+				cv::parallel_for_(cv::Range(0, static_cast<int>(blocks)), [&](const cv::Range& range) {
+					std::vector<float> buffer(static_cast<std::size_t>(length) * blurBlock);
+
+					auto line = static_cast<std::size_t>(range.start) * blurBlock;
+					auto last = std::min(static_cast<std::size_t>(range.end) * blurBlock, lines);
+
+					while (line < last)
+					{
+						auto offset = line % stride;
+						auto count = static_cast<int>(std::min<std::size_t>({ static_cast<std::size_t>(blurBlock), stride - offset, last - line }));
+						auto start = channel.data() + (line / stride) * stride * length + offset;
+
+						for (auto i = 0; i < length; ++i)
+							std::copy(start + i * stride, start + i * stride + count, buffer.data() + i * blurBlock);
+
+						for (auto i = 0; i < length; ++i)
+						{
+							auto output = start + i * stride;
+
+							if (i < 2 || i >= length - 2)
+							{
+								std::fill(output, output + count, 0.0f);
+								continue;
+							}
+
+							auto center = buffer.data() + i * blurBlock;
+
+							for (auto j = 0; j < count; ++j)
+							{
+								output[j] = (center[j - 2 * blurBlock] + center[j + 2 * blurBlock]
+									+ 4 * (center[j - blurBlock] + center[j + blurBlock]) + 6 * center[j]) / 16;
+							}
+						}
+
+						line += count;
+					}
+				});
+			}
+
+			int width_;
+			int height_;
+			int depth_;
+			std::vector<float> values_;
+			std::vector<float> weights_;
+		};
+	}
+
+	cv::Mat bilateralFilter(const cv::Mat& f, double spaceSigma, double rangeSigma)
+	{
+		CV_Assert(f.type() == CV_8U && spaceSigma >= 1 && rangeSigma >= 1);
+
+		auto spaceScale = static_cast<float>(1 / spaceSigma);
+		auto rangeScale = static_cast<float>(1 / rangeSigma);
+
+		auto width = static_cast<int>((f.cols - 1) * spaceScale) + 2 + 2 * padding;
+		auto height = static_cast<int>((f.rows - 1) * spaceScale) + 2 + 2 * padding;
+		auto depth = static_cast<int>(255 * rangeScale) + 2 + 2 * padding;
+
+		CV_Assert(static_cast<double>(width) * height * depth <= maxCells);
+
+		BilateralGrid grid(width, height, depth);
+
+		//The pixel rows of a row of cells are contiguous, the rows of cells are splatted in parallel without sharing cells
+		std::vector<int> firstRow(height + 1, f.rows);
+
+		for (auto y = f.rows - 1; y >= 0; --y)
+			firstRow[static_cast<int>(y * spaceScale + 0.5f) + padding] = y;
+
+		for (auto cellY = height - 1; cellY >= 0; --cellY)
+			firstRow[cellY] = std::min(firstRow[cellY], firstRow[cellY + 1]);
+
+		cv::parallel_for_(cv::Range(0, height), [&](const cv::Range& range) {
+			for (auto cellY = range.start; cellY < range.end; ++cellY)
+			{
+				for (auto y = firstRow[cellY]; y < firstRow[cellY + 1]; ++y)
+				{
+					auto row = f.ptr<uchar>(y);
+
+					for (auto x = 0; x < f.cols; ++x)
+					{
+						grid.splat(static_cast<int>(x * spaceScale + 0.5f) + padding, cellY, static_cast<int>(row[x] * rangeScale + 0.5f) + padding, row[x]);
+					}
+				}
+			}
+		});
+
+		grid.blur(1, grid.width());
+		grid.blur(grid.width(), grid.height());
+		grid.blur(static_cast<std::size_t>(grid.width()) * grid.height(), grid.depth());
+
+		cv::Mat g(f.rows, f.cols, CV_8U);
+
+		cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+			for (auto y = range.start; y < range.end; ++y)
+			{
+				auto row = f.ptr<uchar>(y);
+				auto output = g.ptr<uchar>(y);
+
+				for (auto x = 0; x < f.cols; ++x)
+				{
+					auto value = 0.0f;
+					auto weight = 0.0f;
+
+					grid.slice(x * spaceScale + padding, y * spaceScale + padding, row[x] * rangeScale + padding, value, weight);
+
+					output[x] = weight > 0 ? cv::saturate_cast<uchar>(value / weight) : row[x];
+				}
+			}
+		});
+
+		return g;
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef _BILATERAL_H
+#define _BILATERAL_H
+
+#include <opencv2/opencv.hpp>
+
+namespace dip
+{
+/* Edge preserving smoothing of an 8-bit image by a bilateral grid(Paris and Durand, Chen et al.).
+* Every pixel is added to the nearest cell of a grid of space x intensity whose cells are spaceSigma pixels wide and
+* rangeSigma gray levels deep(splat), the grid is blurred along its three axes by the small [1 4 6 4 1] / 16 kernel and
+* every output is read from the grid at the position of its pixel by trilinear interpolation(slice).
+* The pixels across an edge fall into distant cells of the intensity axis, so they are not averaged together.
+* The grid is about (rows / spaceSigma) x (cols / spaceSigma) x (256 / rangeSigma) cells, so the cost is close to
+* linear in the number of pixels for every spaceSigma. The grid is at most 2^30 cells, larger sigmas are needed for
+* larger images.
+* The cells outside the image are empty, the outputs near the borders are averaged over the pixels of the image only.
+*/
+cv::Mat bilateralFilter(const cv::Mat& f, double spaceSigma, double rangeSigma);
+}
+
+#endif
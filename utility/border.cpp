@@ -0,0 +1,46 @@
+#include "border.h"
+
+namespace dip
+{
+	BorderMode parseBorderMode(const std::string& mode)
+	{
+		if (mode == "replicate")
+			return BorderMode::Replicate;
+
+		if (mode == "reflect")
+			return BorderMode::Reflect;
+
+		if (mode == "wrap")
+			return BorderMode::Wrap;
+
+		return BorderMode::Constant;
+	}
+
+	int borderIndex(int i, int length, BorderMode mode)
+	{
+		if (i >= 0 && i < length)
+			return i;
+
+		switch (mode)
+		{
+		case BorderMode::Replicate:
+			return i < 0 ? 0 : length - 1;
+		case BorderMode::Reflect:
+		{
+			//The reflected line repeats every 2 * length pixels
+			auto period = 2 * length;
+			i %= period;
+
+			if (i < 0)
+				i += period;
+
+			return i < length ? i : period - 1 - i;
+		}
+		case BorderMode::Wrap:
+			i %= length;
+			return i < 0 ? i + length : i;
+		default:
+			return -1;
+		}
+	}
+}
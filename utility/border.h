@@ -0,0 +1,119 @@
+#ifndef _BORDER_H
+#define _BORDER_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace dip
+{
+/* How the pixels outside of an image are generated, for a line abcdefgh
+* Constant  : 000|abcdefgh|000
+* Replicate : aaa|abcdefgh|hhh
+* Reflect   : cba|abcdefgh|hgf
+* Wrap      : fgh|abcdefgh|abc
+*/
+enum class BorderMode
+{
+	Constant,
+	Replicate,
+	Reflect,
+	Wrap
+};
+
+//constant, replicate, reflect or wrap, anything else is constant
+BorderMode parseBorderMode(const std::string& mode);
+
+//Index of the pixel which is read for i in a line of the given length, -1 stands for the constant
+int borderIndex(int i, int length, BorderMode mode);
+
+/* Runs a neighbourhood filter over the columns of n source rows without a padded copy of them.
+* filter(rows, begin, count) computes the outputs of the columns begin .. begin + count - 1, the output of the column
+* begin + i reads rows[t][i + s] for the neighbour at (s - a, t) just like on a padded image,
+* where m is the width of the neighbourhood and a = (m - 1) / 2.
+* The interior columns are read from the source rows directly, the a left and m - 1 - a right columns from
+* a small strip whose pixels are generated by the border mode.
+*/
+template <typename TIn, typename Filter>
+void filterColumns(const TIn* const* source, int n, int cols, int m, BorderMode mode, std::vector<TIn>& strip, Filter filter)
+{
+	auto a = (m - 1) / 2;
+	auto interiorBegin = a;
+	auto interiorEnd = cols - (m - 1 - a);
+	std::vector<const TIn*> rows(n);
+
+	auto filterStrip = [&](int begin, int end) {
+		if (begin == end)
+			return;
+
+		auto width = end - begin + m - 1;
+		strip.resize(n * width);
+
+		for (auto t = 0; t < n; ++t)
+		{
+			auto row = strip.data() + t * width;
+
+			for (auto i = 0; i < width; ++i)
+			{
+				auto x = borderIndex(begin - a + i, cols, mode);
+				row[i] = x < 0 ? TIn(0) : source[t][x];
+			}
+
+			rows[t] = row;
+		}
+
+		filter(rows.data(), begin, end - begin);
+	};
+
+	//The neighbourhoods of a narrow image cross both borders, it is a single strip
+	if (interiorEnd <= interiorBegin)
+	{
+		filterStrip(0, cols);
+		return;
+	}
+
+	filterStrip(0, interiorBegin);
+	//The output at interiorBegin reads the columns from 0 on
+	filter(source, interiorBegin, interiorEnd - interiorBegin);
+	filterStrip(interiorEnd, cols);
+}
+
+/* Runs a neighbourhood filter of n rows and m columns over every row of f, see filterColumns.
+* filter(rows, y, begin, count) computes the outputs of the row y, so a filter may write several outputs.
+* For every row the n source rows are the rows of f around it, the rows outside f are mapped by the border mode
+* or point to a row of zeros.
+*/
+template <typename TIn, typename Filter>
+void scanRows(const cv::Mat& f, int m, int n, BorderMode mode, Filter filter)
+{
+	auto b = (n - 1) / 2;
+	std::vector<const TIn*> source(n);
+	std::vector<TIn> constantRow(f.cols, TIn(0));
+	std::vector<TIn> strip;
+
+	for (auto y = 0; y < f.rows; ++y)
+	{
+		for (auto t = 0; t < n; ++t)
+		{
+			auto row = borderIndex(y + t - b, f.rows, mode);
+			source[t] = row < 0 ? constantRow.data() : f.ptr<TIn>(row);
+		}
+
+		filterColumns(source.data(), n, f.cols, m, mode, strip, [&](const TIn* const* rows, int begin, int count) {
+			filter(rows, y, begin, count);
+		});
+	}
+}
+
+//scanRows with a single output g of the size of f, filter(rows, output, count) writes count pixels of g from output on
+template <typename TIn, typename TOut, typename Filter>
+void filterRows(const cv::Mat& f, cv::Mat& g, int m, int n, BorderMode mode, Filter filter)
+{
+	scanRows<TIn>(f, m, n, mode, [&](const TIn* const* rows, int y, int begin, int count) {
+		filter(rows, g.ptr<TOut>(y) + begin, count);
+	});
+}
+
+}
+
+#endif
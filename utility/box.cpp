@@ -0,0 +1,92 @@
+#include "box.h"
+#include <algorithm>
+#include <vector>
+
+namespace dip
+{
+	cv::Mat boxFilter(const cv::Mat& f, cv::Size size, BorderMode border)
+	{
+		CV_Assert(f.type() == CV_8U && size.width > 0 && size.height > 0);
+
+		auto m = size.width;
+		auto n = size.height;
+		auto a = (m - 1) / 2;
+		auto b = (n - 1) / 2;
+		auto area = m * n;
+		//Columns of the neighbourhoods, the column i is the column i - a of f
+		auto width = f.cols + m - 1;
+
+		std::vector<int> columns(width);
+		std::vector<uchar> zeros(f.cols, 0);
+
+		for (auto i = 0; i < width; ++i)
+		{
+			columns[i] = borderIndex(i - a, f.cols, border);
+		}
+
+		auto sourceRow = [&](int y) {
+			auto row = borderIndex(y, f.rows, border);
+			return row < 0 ? zeros.data() : f.ptr<uchar>(row);
+		};
+
+		cv::Mat g(f.rows, f.cols, CV_8U);
+
+		//A stripe should be a few neighbourhoods high, otherwise the column sums of its first row dominate
+		auto stripes = std::max(1, std::min(cv::getNumThreads(), f.rows / (2 * n)));
+
+		cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+			std::vector<int> columnSums(width, 0);
+
+			//A row leaves and a row enters the column sums, the interior columns are read directly
+			auto slide = [&](const uchar* leaving, const uchar* entering) {
+				auto sums = columnSums.data() + a;
+
+				for (auto x = 0; x < f.cols; ++x)
+				{
+					sums[x] += entering[x] - leaving[x];
+				}
+
+				auto slideBorder = [&](int begin, int end) {
+					for (auto i = begin; i < end; ++i)
+					{
+						if (columns[i] >= 0)
+							columnSums[i] += entering[columns[i]] - leaving[columns[i]];
+					}
+				};
+
+				slideBorder(0, a);
+				slideBorder(a + f.cols, width);
+			};
+
+			for (auto t = 0; t < n; ++t)
+			{
+				slide(zeros.data(), sourceRow(range.start + t - b));
+			}
+
+			for (auto y = range.start; y < range.end; ++y)
+			{
+				auto output = g.ptr<uchar>(y);
+				auto sum = 0;
+
+				for (auto s = 0; s < m; ++s)
+				{
+					sum += columnSums[s];
+				}
+
+				output[0] = static_cast<uchar>(sum / area);
+
+				for (auto x = 1; x < f.cols; ++x)
+				{
+					sum += columnSums[x + m - 1] - columnSums[x - 1];
+					output[x] = static_cast<uchar>(sum / area);
+				}
+
+				//Slide the column sums down by one row
+				if (y + 1 < range.end)
+					slide(sourceRow(y - b), sourceRow(y + n - b));
+			}
+		}, stripes);
+
+		return g;
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef _BOX_H
+#define _BOX_H
+
+#include <opencv2/opencv.hpp>
+#include "border.h"
+
+namespace dip
+{
+/* Box filter of any size on an 8-bit image, every output is the truncated mean of its width x height neighbourhood.
+* The sums of the height pixels of every column are kept and slid down by one row(one pixel leaves, one enters),
+* the sum of the neighbourhood is slid along the row over those column sums, so a pixel costs the same for every size.
+* The rows are filtered in parallel stripes, each stripe starts with its own column sums.
+*/
+cv::Mat boxFilter(const cv::Mat& f, cv::Size size, BorderMode border = BorderMode::Constant);
+}
+
+#endif
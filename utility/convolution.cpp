@@ -0,0 +1,106 @@
+#include "convolution.h"
+#include <algorithm>
+#include <limits>
+
+namespace dip
+{
+	namespace
+	{
+		//Seconds per tap of the spatial path and per DFT point(n log2 n) of a frequency domain block
+		struct CorrelationCosts
+		{
+			double tap;
+			double dftPoint;
+		};
+
+		//Best of a few runs, so a preempted run doesn't spoil the estimate
+		template <typename Function>
+		double measure(Function function)
+		{
+			auto best = std::numeric_limits<double>::max();
+
+			for (auto i = 0; i < 3; ++i)
+			{
+				auto start = cv::getTickCount();
+				function();
+				best = std::min(best, (cv::getTickCount() - start) / cv::getTickFrequency());
+			}
+
+			return best;
+		}
+
+		CorrelationCosts measureCosts()
+		{
+			const auto size = 64;
+			const auto k = 7;
+
+			cv::RNG rng(0);
+			cv::Mat f(size, size, CV_8U);
+			cv::Mat w(k, k, CV_32S);
+			rng.fill(f, cv::RNG::UNIFORM, 0, 256);
+			rng.fill(w, cv::RNG::UNIFORM, -8, 8);
+
+			CorrelationCosts costs;
+
+			//A random kernel is not separable, so all of its taps are measured
+			costs.tap = measure([&]() {
+				correlate<uchar, int, int>(f, w, [](int result) { return result; });
+			}) / (size * size * k * k);
+
+			cv::Mat block(size, size, CV_64F);
+			cv::Mat kernelSpectrum;
+			cv::Mat spectrum;
+			cv::Mat blockResult;
+			rng.fill(block, cv::RNG::UNIFORM, 0, 256);
+			cv::dft(block, kernelSpectrum, cv::DFT_COMPLEX_OUTPUT);
+
+			auto points = static_cast<double>(size * size);
+
+			costs.dftPoint = measure([&]() {
+				cv::dft(block, spectrum, cv::DFT_COMPLEX_OUTPUT);
+				cv::mulSpectrums(spectrum, kernelSpectrum, spectrum, 0);
+				cv::dft(spectrum, blockResult, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+			}) / (points * std::log2(points));
+
+			return costs;
+		}
+	}
+
+	CorrelationMethod parseCorrelationMethod(const std::string& method)
+	{
+		if (method == "direct")
+			return CorrelationMethod::Direct;
+
+		if (method == "fft")
+			return CorrelationMethod::Fft;
+
+		return CorrelationMethod::Automatic;
+	}
+
+	void fftBlock(int length, int k, int& tile, int& dftLength)
+	{
+		//Tiles of about three kernel sizes keep the overlapping part of a block small,
+		//an image which is smaller than that is transformed as a single tile
+		dftLength = cv::getOptimalDFTSize(std::min(4 * k, length + k - 1));
+		tile = dftLength - k + 1;
+	}
+
+	CorrelationMethod chooseCorrelationMethod(cv::Size image, cv::Size kernel, bool separable)
+	{
+		static const auto costs = measureCosts();
+
+		auto taps = separable ? kernel.width + kernel.height : kernel.width * kernel.height;
+		auto direct = costs.tap * image.width * image.height * taps;
+
+		int tileRows, dftRows, tileCols, dftCols;
+		fftBlock(image.height, kernel.height, tileRows, dftRows);
+		fftBlock(image.width, kernel.width, tileCols, dftCols);
+
+		auto blocks = ((image.height + tileRows - 1) / tileRows) * ((image.width + tileCols - 1) / tileCols);
+		auto points = static_cast<double>(dftRows) * dftCols;
+		//One more block for the spectrum of the kernel
+		auto fft = costs.dftPoint * points * std::log2(points) * (blocks + 1);
+
+		return fft < direct ? CorrelationMethod::Fft : CorrelationMethod::Direct;
+	}
+}
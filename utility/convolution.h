@@ -0,0 +1,511 @@
+#ifndef _CONVOLUTION_H
+#define _CONVOLUTION_H
+
+#include <cmath>
+#include <cstdlib>
+#include <type_traits>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "border.h"
+
+namespace dip
+{
+//Coefficients of w converted to T, in row major order
+template <typename T>
+std::vector<T> kernelCoefficients(const cv::Mat& w)
+{
+	cv::Mat converted;
+	w.convertTo(converted, cv::DataType<T>::type);
+
+	std::vector<T> coefficients;
+	coefficients.reserve(w.rows * w.cols);
+
+	for (auto t = 0; t < converted.rows; ++t)
+	{
+		auto row = converted.ptr<T>(t);
+		coefficients.insert(coefficients.end(), row, row + converted.cols);
+	}
+
+	return coefficients;
+}
+
+/* Factors a rank 1 kernel w into column * row, so w(t, s) = column[t] * row[s].
+* Integer valued kernels are factored exactly: the first non zero row divided by the gcd of its taps is the row factor
+* and every row of w must be an integer multiple of it. Other kernels are factored around their largest tap.
+* Returns false when w is not separable.
+*/
+template <typename TAcc>
+bool factorKernel(const cv::Mat& w, std::vector<TAcc>& column, std::vector<TAcc>& row)
+{
+	auto m = w.cols;
+	auto n = w.rows;
+	auto converted = kernelCoefficients<TAcc>(w);
+	std::vector<double> coefficients(converted.begin(), converted.end());
+
+	auto integral = true;
+	auto pivot = 0;
+
+	for (auto i = 0; i < m * n; ++i)
+	{
+		integral = integral && coefficients[i] == std::round(coefficients[i]);
+
+		if (std::abs(coefficients[i]) > std::abs(coefficients[pivot]))
+			pivot = i;
+	}
+
+	//An all zero kernel is left to the 2D path
+	if (coefficients[pivot] == 0)
+		return false;
+
+	std::vector<double> columnFactor(n);
+	std::vector<double> rowFactor(m);
+
+	if (integral)
+	{
+		auto first = 0;
+
+		while (coefficients[first] == 0)
+			++first;
+
+		auto firstRow = first / m;
+		auto divisor = 0LL;
+
+		for (auto s = 0; s < m; ++s)
+		{
+			auto a = std::llabs(static_cast<long long>(coefficients[firstRow * m + s]));
+			auto b = divisor;
+
+			while (b != 0)
+			{
+				auto r = a % b;
+				a = b;
+				b = r;
+			}
+
+			divisor = a;
+		}
+
+		for (auto s = 0; s < m; ++s)
+		{
+			rowFactor[s] = static_cast<long long>(coefficients[firstRow * m + s]) / divisor;
+		}
+
+		auto anchor = first % m;
+
+		for (auto t = 0; t < n; ++t)
+		{
+			auto value = static_cast<long long>(coefficients[t * m + anchor]);
+			auto factor = static_cast<long long>(rowFactor[anchor]);
+
+			if (value % factor != 0)
+				return false;
+
+			columnFactor[t] = value / factor;
+		}
+	}
+	else
+	{
+		auto pivotRow = pivot / m;
+		auto pivotColumn = pivot % m;
+
+		for (auto t = 0; t < n; ++t)
+		{
+			columnFactor[t] = coefficients[t * m + pivotColumn];
+		}
+
+		for (auto s = 0; s < m; ++s)
+		{
+			rowFactor[s] = coefficients[pivotRow * m + s] / coefficients[pivot];
+		}
+	}
+
+	auto tolerance = integral ? 0.0 : 1e-9 * std::abs(coefficients[pivot]);
+
+	for (auto t = 0; t < n; ++t)
+	{
+		for (auto s = 0; s < m; ++s)
+		{
+			if (std::abs(columnFactor[t] * rowFactor[s] - coefficients[t * m + s]) > tolerance)
+				return false;
+		}
+	}
+
+	column.assign(columnFactor.begin(), columnFactor.end());
+	row.assign(rowFactor.begin(), rowFactor.end());
+
+	return true;
+}
+
+/* A kernel prepared once for the filters which use it many times, e.g. on every frame.
+* The coefficients are converted to TAcc and laid out contiguously in row major order and rank 1 kernels are factored
+* at construction. The kernel of a convolution is rotated by 180 degrees at construction too,
+* so the filters don't rotate, convert or factor it again.
+*/
+template <typename TAcc>
+class Kernel
+{
+public:
+	static Kernel correlation(const cv::Mat& w)
+	{
+		return Kernel(w.clone());
+	}
+
+	//Convolution is the correlation with w rotated by 180 degrees
+	static Kernel convolution(const cv::Mat& w)
+	{
+		cv::Mat rotated;
+		cv::rotate(w, rotated, cv::ROTATE_180);
+
+		return Kernel(rotated);
+	}
+
+	int rows() const { return w_.rows; }
+	int cols() const { return w_.cols; }
+	cv::Size size() const { return w_.size(); }
+	//The kernel as it is correlated
+	const cv::Mat& mat() const { return w_; }
+	const std::vector<TAcc>& coefficients() const { return coefficients_; }
+
+	bool separable() const { return separable_; }
+	const std::vector<TAcc>& column() const { return column_; }
+	const std::vector<TAcc>& row() const { return row_; }
+
+private:
+	explicit Kernel(const cv::Mat& w)
+		: w_(w),
+		  coefficients_(kernelCoefficients<TAcc>(w)),
+		  separable_(factorKernel(w, column_, row_))
+	{
+	}
+
+	cv::Mat w_;
+	std::vector<TAcc> coefficients_;
+	std::vector<TAcc> column_;
+	std::vector<TAcc> row_;
+	bool separable_;
+};
+
+/* Two pass filtering with a separable kernel of n rows and m columns, its cost per pixel is m + n instead of m * n.
+* rowPass(row, x) returns the horizontal sum of the m neighbours of a row which start at x, as on a padded row,
+* columnPass(sums, x) returns the vertical sum of the n horizontal sums at x.
+* The horizontal sums of the last n rows are kept in a ring buffer, so every row is filtered once.
+* The rows and the columns outside f are generated by the border mode, f is not copied.
+*/
+template <typename TIn, typename TAcc, typename TOut, typename RowPass, typename ColumnPass, typename Store>
+cv::Mat separableFilter(const cv::Mat& f, int m, int n, BorderMode border, RowPass rowPass, ColumnPass columnPass, Store store)
+{
+	auto b = (n - 1) / 2;
+
+	cv::Mat g(f.rows, f.cols, cv::DataType<TOut>::type);
+	std::vector<TAcc> ring(n * f.cols);
+	std::vector<const TAcc*> sums(n);
+	std::vector<TIn> constantRow(f.cols, TIn(0));
+	std::vector<TIn> strip;
+
+	//y is the index of the row on a padded image, it is y - b on f
+	auto filterRow = [&](int y) {
+		auto row = borderIndex(y - b, f.rows, border);
+		const TIn* source = row < 0 ? constantRow.data() : f.ptr<TIn>(row);
+
+		auto sums = ring.data() + (y % n) * f.cols;
+
+		filterColumns(&source, 1, f.cols, m, border, strip, [&](const TIn* const* rows, int begin, int count) {
+			for (auto x = 0; x < count; ++x)
+			{
+				sums[begin + x] = rowPass(rows[0], x);
+			}
+		});
+	};
+
+	for (auto y = 0; y < n - 1; ++y)
+	{
+		filterRow(y);
+	}
+
+	for (auto y = 0; y < g.rows; ++y)
+	{
+		filterRow(y + n - 1);
+
+		for (auto t = 0; t < n; ++t)
+		{
+			sums[t] = ring.data() + ((y + t) % n) * f.cols;
+		}
+
+		auto output = g.ptr<TOut>(y);
+
+		for (auto x = 0; x < g.cols; ++x)
+		{
+			output[x] = store(columnPass(sums.data(), x));
+		}
+	}
+
+	return g;
+}
+
+//Correlation with the kernel column * row, see separableFilter
+template <typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlateSeparable(const cv::Mat& f, const std::vector<TAcc>& column, const std::vector<TAcc>& row, Store store, BorderMode border)
+{
+	auto m = static_cast<int>(row.size());
+	auto n = static_cast<int>(column.size());
+
+	auto rowPass = [&row, m](const TIn* input, int x) {
+		auto result = TAcc(0);
+
+		for (auto s = 0; s < m; ++s)
+		{
+			result += row[s] * input[x + s];
+		}
+
+		return result;
+	};
+
+	auto columnPass = [&column, n](const TAcc* const* sums, int x) {
+		auto result = TAcc(0);
+
+		for (auto t = 0; t < n; ++t)
+		{
+			result += column[t] * sums[t][x];
+		}
+
+		return result;
+	};
+
+	return separableFilter<TIn, TAcc, TOut>(f, m, n, border, rowPass, columnPass, store);
+}
+
+/* Spatial correlation, Equation : 3.4-1
+*                   a   b
+* g(x, y) = store(  E   E  w(s, t) f(x + s, y + t) )
+*                  s=-a t=-b
+* TIn is the pixel type of f, the products are summed in TAcc and g is made of TOut pixels.
+* store converts the sum of a pixel to its output value, so the callers keep their own clamping or normalisation.
+* The neighbourhoods are read through row pointers of f, the pixels outside f are generated by the border mode.
+* Rank 1 kernels(box, weighted average, Sobel, ...) are detected and filtered in two 1D passes.
+*/
+template <typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlate(const cv::Mat& f, const Kernel<TAcc>& w, Store store, BorderMode border = BorderMode::Constant)
+{
+	if (w.separable())
+		return correlateSeparable<TIn, TAcc, TOut>(f, w.column(), w.row(), store, border);
+
+	auto m = w.cols();
+	auto n = w.rows();
+
+	auto coefficients = w.coefficients().data();
+
+	cv::Mat g(f.rows, f.cols, cv::DataType<TOut>::type);
+
+	filterRows<TIn, TOut>(f, g, m, n, border, [&](const TIn* const* rows, TOut* output, int count) {
+		for (auto x = 0; x < count; ++x)
+		{
+			auto result = TAcc(0);
+			auto coefficient = coefficients;
+
+			//w(x,y) * f(x,y) = w(s,t) * f(x + s, y + t)
+			for (auto t = 0; t < n; ++t)
+			{
+				auto neighbours = rows[t] + x;
+
+				for (auto s = 0; s < m; ++s)
+				{
+					result += *coefficient++ * neighbours[s];
+				}
+			}
+
+			output[x] = store(result);
+		}
+	});
+
+	return g;
+}
+
+template <typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlate(const cv::Mat& f, const cv::Mat& w, Store store, BorderMode border = BorderMode::Constant)
+{
+	return correlate<TIn, TAcc, TOut>(f, Kernel<TAcc>::correlation(w), store, border);
+}
+
+//Tile and DFT lengths of the overlap-add blocks along a dimension of the given length and kernel size k
+void fftBlock(int length, int k, int& tile, int& dftLength);
+
+/* Correlation in the frequency domain, the result equals correlate within floating point tolerance.
+* f is cut into tiles(overlap-add), every tile is transformed, multiplied with the spectrum of the rotated kernel
+* and transformed back. The (tile + k - 1) sized results of neighbouring tiles overlap and are added up.
+* The tiles are cut from f extended by the border mode, which is generated while the tiles are copied.
+* A row of tiles is added into a band of its own rows and the n - 1 rows it overlaps below, the finished rows of the band
+* are stored into g and only the overlapping rows are carried to the next row of tiles, so the memory is a band of rows
+* however large f is. The tiles of a row are filtered in parallel.
+* Integer TAcc sums are rounded before store, so they are the same as the ones of the spatial path.
+*/
+template <typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlateFft(const cv::Mat& f, const cv::Mat& w, Store store, BorderMode border = BorderMode::Constant)
+{
+	auto m = w.cols;
+	auto n = w.rows;
+	auto a = (m - 1) / 2;
+	auto b = (n - 1) / 2;
+
+	//The extended image, its pixel (x, y) is f(x - a, y - b)
+	auto rows = f.rows + n - 1;
+	auto cols = f.cols + m - 1;
+	std::vector<int> columns(cols);
+
+	for (auto x = 0; x < cols; ++x)
+	{
+		columns[x] = borderIndex(x - a, f.cols, border);
+	}
+
+	int tileRows, dftRows, tileCols, dftCols;
+	fftBlock(rows, n, tileRows, dftRows);
+	fftBlock(cols, m, tileCols, dftCols);
+
+	//Correlation is the convolution with w rotated by 180 degrees
+	auto coefficients = kernelCoefficients<double>(w);
+	cv::Mat kernel = cv::Mat::zeros(dftRows, dftCols, CV_64F);
+
+	for (auto t = 0; t < n; ++t)
+	{
+		auto row = kernel.ptr<double>(n - 1 - t);
+
+		for (auto s = 0; s < m; ++s)
+		{
+			row[m - 1 - s] = coefficients[t * m + s];
+		}
+	}
+
+	cv::Mat kernelSpectrum;
+	cv::dft(kernel, kernelSpectrum, cv::DFT_COMPLEX_OUTPUT, n);
+
+	//The band row r is the row ty + r of the full linear convolution of the extended image
+	cv::Mat band = cv::Mat::zeros(tileRows + n - 1, cols + m - 1, CV_64F);
+	cv::Mat g(f.rows, f.cols, cv::DataType<TOut>::type);
+	auto tiles = (cols + tileCols - 1) / tileCols;
+
+	for (auto ty = 0; ty < rows; ty += tileRows)
+	{
+		auto th = std::min(tileRows, rows - ty);
+
+		//Only neighbouring tiles overlap(a tile is longer than the m - 1 overlapping columns),
+		//so the even tiles and then the odd tiles are added into the band in parallel
+		for (auto parity = 0; parity < 2; ++parity)
+		{
+			cv::parallel_for_(cv::Range(0, (tiles + 1 - parity) / 2), [&](const cv::Range& range) {
+				cv::Mat block(dftRows, dftCols, CV_64F);
+				cv::Mat spectrum;
+				cv::Mat blockResult;
+
+				for (auto i = range.start; i < range.end; ++i)
+				{
+					auto tx = (2 * i + parity) * tileCols;
+					auto tw = std::min(tileCols, cols - tx);
+
+					block.setTo(cv::Scalar(0));
+
+					for (auto y = 0; y < th; ++y)
+					{
+						auto row = borderIndex(ty + y - b, f.rows, border);
+
+						if (row < 0)
+							continue;
+
+						auto input = f.ptr<TIn>(row);
+						auto column = columns.data() + tx;
+						auto output = block.ptr<double>(y);
+
+						for (auto x = 0; x < tw; ++x)
+						{
+							output[x] = column[x] < 0 ? 0.0 : static_cast<double>(input[column[x]]);
+						}
+					}
+
+					cv::dft(block, spectrum, cv::DFT_COMPLEX_OUTPUT, th);
+					cv::mulSpectrums(spectrum, kernelSpectrum, spectrum, 0);
+					cv::dft(spectrum, blockResult, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, th + n - 1);
+
+					for (auto y = 0; y < th + n - 1; ++y)
+					{
+						auto input = blockResult.ptr<double>(y);
+						auto output = band.ptr<double>(y) + tx;
+
+						for (auto x = 0; x < tw + m - 1; ++x)
+						{
+							output[x] += input[x];
+						}
+					}
+				}
+			});
+		}
+
+		//No later row of tiles reaches the rows above ty + th, g(x, y) is at (x + m - 1, y + n - 1) of the full convolution
+		auto first = std::max(0, ty - (n - 1));
+		auto last = std::min(f.rows, ty + th - (n - 1));
+
+		for (auto y = first; y < last; ++y)
+		{
+			auto input = band.ptr<double>(y + n - 1 - ty) + m - 1;
+			auto output = g.ptr<TOut>(y);
+
+			for (auto x = 0; x < g.cols; ++x)
+			{
+				output[x] = store(static_cast<TAcc>(std::is_integral<TAcc>::value ? std::round(input[x]) : input[x]));
+			}
+		}
+
+		//The n - 1 rows below the tiles are the top of the band of the next row of tiles
+		for (auto y = 0; y < n - 1; ++y)
+		{
+			band.row(th + y).copyTo(band.row(y));
+		}
+
+		band.rowRange(n - 1, band.rows).setTo(cv::Scalar(0));
+	}
+
+	return g;
+}
+
+enum class CorrelationMethod
+{
+	Automatic,
+	Direct,
+	Fft
+};
+
+//direct, fft or automatic, anything else is automatic
+CorrelationMethod parseCorrelationMethod(const std::string& method);
+
+/* Crossover between the spatial and the frequency domain paths.
+* The cost of a tap of the spatial path and the cost of a DFT point are measured once per process on small
+* synthetic inputs, then both paths are estimated for the image and kernel sizes and the cheaper one is chosen.
+* Separable kernels cost m + n taps per pixel in the spatial path.
+*/
+CorrelationMethod chooseCorrelationMethod(cv::Size image, cv::Size kernel, bool separable);
+
+//correlate with an explicit or an automatically chosen method
+template <typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlate(const cv::Mat& f, const Kernel<TAcc>& w, Store store, CorrelationMethod method, BorderMode border = BorderMode::Constant)
+{
+	if (method == CorrelationMethod::Automatic)
+		method = chooseCorrelationMethod(f.size(), w.size(), w.separable());
+
+	if (method == CorrelationMethod::Fft)
+		return correlateFft<TIn, TAcc, TOut>(f, w.mat(), store, border);
+
+	return correlate<TIn, TAcc, TOut>(f, w, store, border);
+}
+
+template <typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat correlate(const cv::Mat& f, const cv::Mat& w, Store store, CorrelationMethod method, BorderMode border = BorderMode::Constant)
+{
+	return correlate<TIn, TAcc, TOut>(f, Kernel<TAcc>::correlation(w), store, method, border);
+}
+
+template <typename TIn, typename TAcc, typename TOut, typename Store>
+cv::Mat convolve(const cv::Mat& f, const cv::Mat& w, Store store, CorrelationMethod method = CorrelationMethod::Direct, BorderMode border = BorderMode::Constant)
+{
+	return correlate<TIn, TAcc, TOut>(f, Kernel<TAcc>::convolution(w), store, method, border);
+}
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "denoise.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace dip
+{
+	namespace
+	{
+		//The pixel x of a row of f, the columns outside f are generated by the border mode
+		int pixel(const uchar* row, int x, int cols, BorderMode border)
+		{
+			auto column = borderIndex(x, cols, border);
+			return column < 0 ? 0 : row[column];
+		}
+
+		//The columns begin .. end - 1 of a line of length pixels which read the row of f at x + shift within f
+		void interior(int shift, int offset, int cols, int length, int& begin, int& end)
+		{
+			begin = std::min(length, std::max(0, offset + std::max(0, -shift)));
+			end = std::max(begin, std::min(length, offset + cols - std::max(0, shift)));
+		}
+	}
+
+	cv::Mat nonLocalMeans(const cv::Mat& f, int patchSize, int searchSize, double h, BorderMode border)
+	{
+		CV_Assert(f.type() == CV_8U && patchSize % 2 == 1 && searchSize % 2 == 1 && h > 0);
+
+		auto patchRadius = patchSize / 2;
+		auto searchRadius = searchSize / 2;
+		//The patches of the farthest pixels of the search windows reach margin pixels out of the image
+		auto margin = searchRadius + patchRadius;
+		std::vector<uchar> constantRow(f.cols, 0);
+
+		//d / h^2 with d as the mean of the patch
+		auto scale = static_cast<float>(1.0 / (h * h * patchSize * patchSize));
+		cv::Mat g(f.rows, f.cols, CV_8U);
+
+		cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+			auto rows = range.end - range.start;
+			//The patches of the band, the patch of the output (y, x) starts at (y - range.start, x)
+			auto regionRows = rows + patchSize - 1;
+			auto regionCols = f.cols + patchSize - 1;
+			auto stride = regionCols + 1;
+
+			//The rows of f from margin rows above the band to margin rows below it, the rows outside f are mapped by the border mode
+			std::vector<const uchar*> source(rows + 2 * margin);
+
+			for (auto i = 0; i < static_cast<int>(source.size()); ++i)
+			{
+				auto row = borderIndex(range.start - margin + i, f.rows, border);
+				source[i] = row < 0 ? constantRow.data() : f.ptr<uchar>(row);
+			}
+
+			//The squared differences are integers, their sums are exact in double
+			std::vector<double> integral((regionRows + 1) * stride, 0.0);
+			std::vector<float> sums(rows * f.cols, 0.0f);
+			std::vector<float> weights(rows * f.cols, 0.0f);
+			std::vector<float> maxWeights(rows * f.cols, 0.0f);
+
+			for (auto dy = -searchRadius; dy <= searchRadius; ++dy)
+			{
+				for (auto dx = -searchRadius; dx <= searchRadius; ++dx)
+				{
+					if (dx == 0 && dy == 0)
+						continue;
+
+					//The column c of the region is the pixel c - patchRadius of a row and c - patchRadius + dx of the shifted row
+					int begin, end;
+					interior(dx, patchRadius, f.cols, regionCols, begin, end);
+
+					for (auto r = 0; r < regionRows; ++r)
+					{
+						auto patch = source[searchRadius + r];
+						auto shifted = source[searchRadius + r + dy];
+						auto above = integral.data() + r * stride;
+						auto current = above + stride;
+						auto rowSum = 0.0;
+
+						auto add = [&](int c, int difference) {
+							rowSum += difference * difference;
+							current[c + 1] = above[c + 1] + rowSum;
+						};
+
+						for (auto c = 0; c < begin; ++c)
+						{
+							add(c, pixel(patch, c - patchRadius, f.cols, border) - pixel(shifted, c - patchRadius + dx, f.cols, border));
+						}
+
+						for (auto c = begin; c < end; ++c)
+						{
+							add(c, patch[c - patchRadius] - shifted[c - patchRadius + dx]);
+						}
+
+						for (auto c = end; c < regionCols; ++c)
+						{
+							add(c, pixel(patch, c - patchRadius, f.cols, border) - pixel(shifted, c - patchRadius + dx, f.cols, border));
+						}
+					}
+
+					interior(dx, 0, f.cols, f.cols, begin, end);
+
+					for (auto y = 0; y < rows; ++y)
+					{
+						auto top = integral.data() + y * stride;
+						auto bottom = top + patchSize * stride;
+						auto neighbours = source[y + margin + dy];
+						auto offset = y * f.cols;
+
+						auto add = [&](int x, int neighbour) {
+							auto distance = static_cast<float>(bottom[x + patchSize] - bottom[x] - top[x + patchSize] + top[x]);
+							auto weight = std::exp(-distance * scale);
+
+							sums[offset + x] += weight * neighbour;
+							weights[offset + x] += weight;
+							maxWeights[offset + x] = std::max(maxWeights[offset + x], weight);
+						};
+
+						for (auto x = 0; x < begin; ++x)
+						{
+							add(x, pixel(neighbours, x + dx, f.cols, border));
+						}
+
+						for (auto x = begin; x < end; ++x)
+						{
+							add(x, neighbours[x + dx]);
+						}
+
+						for (auto x = end; x < f.cols; ++x)
+						{
+							add(x, pixel(neighbours, x + dx, f.cols, border));
+						}
+					}
+				}
+			}
+
+			for (auto y = 0; y < rows; ++y)
+			{
+				auto centres = f.ptr<uchar>(range.start + y);
+				auto output = g.ptr<uchar>(range.start + y);
+				auto offset = y * f.cols;
+
+				for (auto x = 0; x < f.cols; ++x)
+				{
+					//A pixel which is not similar to any other keeps its value
+					auto self = std::max(maxWeights[offset + x], 1e-6f);
+
+					output[x] = cv::saturate_cast<uchar>((sums[offset + x] + self * centres[x]) / (weights[offset + x] + self));
+				}
+			}
+		});
+
+		return g;
+	}
+}
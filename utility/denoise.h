@@ -0,0 +1,20 @@
+#ifndef _DENOISE_H
+#define _DENOISE_H
+
+#include <opencv2/opencv.hpp>
+#include "border.h"
+
+namespace dip
+{
+/* Non-local means denoising of an 8-bit image(Buades et al.). Every output is the weighted mean of the pixels in its
+* searchSize x searchSize window, a pixel is weighted by exp(-d / h^2), where d is the mean squared difference of
+* the patchSize x patchSize patches around it and around the output. The pixel itself gets the largest weight of the others.
+* The patch distances are not summed patch by patch, for every offset of the search window the squared differences of
+* the image and its shifted copy are summed into an integral image and every patch distance is read from it in O(1)(Darbon et al.),
+* so a pixel costs O(searchSize^2) for every patchSize. The rows are denoised in parallel bands, the sums are float32.
+* The sizes are odd.
+*/
+cv::Mat nonLocalMeans(const cv::Mat& f, int patchSize, int searchSize, double h, BorderMode border = BorderMode::Constant);
+}
+
+#endif
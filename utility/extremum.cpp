@@ -0,0 +1,155 @@
+#include "extremum.h"
+#include <algorithm>
+#include <vector>
+
+namespace dip
+{
+	namespace
+	{
+		struct Minimum
+		{
+			uchar operator()(uchar a, uchar b) const { return std::min(a, b); }
+		};
+
+		struct Maximum
+		{
+			uchar operator()(uchar a, uchar b) const { return std::max(a, b); }
+		};
+
+		//Extremum of every window of m pixels along the rows
+		template <typename Op>
+		void filterRowExtremum(const cv::Mat& f, cv::Mat& g, int m, BorderMode border, Op op)
+		{
+			auto a = (m - 1) / 2;
+			//The window of x covers x .. x + m - 1 of a line which starts a pixels before the row
+			auto length = f.cols + m - 1;
+
+			std::vector<int> columns(length);
+
+			for (auto i = 0; i < length; ++i)
+			{
+				columns[i] = borderIndex(i - a, f.cols, border);
+			}
+
+			cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+				std::vector<uchar> line(length);
+				std::vector<uchar> forward(length);
+				std::vector<uchar> backward(length);
+
+				for (auto y = range.start; y < range.end; ++y)
+				{
+					auto row = f.ptr<uchar>(y);
+
+					for (auto i = 0; i < length; ++i)
+					{
+						line[i] = columns[i] < 0 ? 0 : row[columns[i]];
+					}
+
+					for (auto start = 0; start < length; start += m)
+					{
+						auto end = std::min(start + m, length);
+
+						forward[start] = line[start];
+
+						for (auto i = start + 1; i < end; ++i)
+						{
+							forward[i] = op(forward[i - 1], line[i]);
+						}
+
+						backward[end - 1] = line[end - 1];
+
+						for (auto i = end - 2; i >= start; --i)
+						{
+							backward[i] = op(backward[i + 1], line[i]);
+						}
+					}
+
+					auto output = g.ptr<uchar>(y);
+
+					for (auto x = 0; x < f.cols; ++x)
+					{
+						output[x] = op(backward[x], forward[x + m - 1]);
+					}
+				}
+			});
+		}
+
+		//Extremum of every window of n pixels along the columns, a whole row is a lane of the running extrema
+		template <typename Op>
+		void filterColumnExtremum(const cv::Mat& f, cv::Mat& g, int n, BorderMode border, Op op)
+		{
+			auto b = (n - 1) / 2;
+			auto length = f.rows + n - 1;
+
+			std::vector<uchar> zeros(f.cols, 0);
+			std::vector<const uchar*> lines(length);
+
+			for (auto i = 0; i < length; ++i)
+			{
+				auto row = borderIndex(i - b, f.rows, border);
+				lines[i] = row < 0 ? zeros.data() : f.ptr<uchar>(row);
+			}
+
+			cv::Mat forward(length, f.cols, CV_8U);
+			cv::Mat backward(length, f.cols, CV_8U);
+
+			//The columns are independent, every stripe filters a range of them
+			cv::parallel_for_(cv::Range(0, f.cols), [&](const cv::Range& range) {
+				auto combine = [&](uchar* output, const uchar* first, const uchar* second) {
+					for (auto x = range.start; x < range.end; ++x)
+					{
+						output[x] = op(first[x], second[x]);
+					}
+				};
+
+				for (auto start = 0; start < length; start += n)
+				{
+					auto end = std::min(start + n, length);
+
+					std::copy(lines[start] + range.start, lines[start] + range.end, forward.ptr<uchar>(start) + range.start);
+
+					for (auto i = start + 1; i < end; ++i)
+					{
+						combine(forward.ptr<uchar>(i), forward.ptr<uchar>(i - 1), lines[i]);
+					}
+
+					std::copy(lines[end - 1] + range.start, lines[end - 1] + range.end, backward.ptr<uchar>(end - 1) + range.start);
+
+					for (auto i = end - 2; i >= start; --i)
+					{
+						combine(backward.ptr<uchar>(i), backward.ptr<uchar>(i + 1), lines[i]);
+					}
+				}
+
+				for (auto y = 0; y < f.rows; ++y)
+				{
+					combine(g.ptr<uchar>(y), backward.ptr<uchar>(y), forward.ptr<uchar>(y + n - 1));
+				}
+			});
+		}
+
+		template <typename Op>
+		cv::Mat extremumFilter(const cv::Mat& f, cv::Size size, BorderMode border, Op op)
+		{
+			CV_Assert(f.type() == CV_8U && size.width > 0 && size.height > 0);
+
+			cv::Mat rows(f.rows, f.cols, CV_8U);
+			cv::Mat g(f.rows, f.cols, CV_8U);
+
+			filterRowExtremum(f, rows, size.width, border, op);
+			filterColumnExtremum(rows, g, size.height, border, op);
+
+			return g;
+		}
+	}
+
+	cv::Mat minFilter(const cv::Mat& f, cv::Size size, BorderMode border)
+	{
+		return extremumFilter(f, size, border, Minimum());
+	}
+
+	cv::Mat maxFilter(const cv::Mat& f, cv::Size size, BorderMode border)
+	{
+		return extremumFilter(f, size, border, Maximum());
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef _EXTREMUM_H
+#define _EXTREMUM_H
+
+#include <opencv2/opencv.hpp>
+#include "border.h"
+
+namespace dip
+{
+/* Minimum(erosion) and maximum(dilation) of every width x height neighbourhood of an 8-bit image.
+* The rectangle is separable, the rows are filtered first and the columns of the result afterwards.
+* A line is cut into blocks of the window length k, the running extremum from the start of every block(g) and
+* towards its end(h) are kept, a window starting at x covers the end of a block and the start of the next one,
+* so its extremum is op(h(x), g(x + k - 1)), van Herk and Gil-Werman.
+* That is about three comparisons per pixel and pass for every size.
+*/
+cv::Mat minFilter(const cv::Mat& f, cv::Size size, BorderMode border = BorderMode::Constant);
+cv::Mat maxFilter(const cv::Mat& f, cv::Size size, BorderMode border = BorderMode::Constant);
+}
+
+#endif
@@ -0,0 +1,278 @@
+#include "gaussian.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "convolution.h"
+#include "simd.h"
+
+namespace dip
+{
+	namespace
+	{
+		//Poles of the recursion of Young, van Vliet and van Ginkel for sigma 2, the poles of the other sigmas are their 1 / q powers
+		const std::complex<double> BasePoles[3] = { { 1.41650, 1.00829 }, { 1.41650, -1.00829 }, { 1.86543, 0.0 } };
+
+		//The poles p of the factors 1 - p z^-1 of the recursion of scale q
+		void scalePoles(double q, std::complex<double>* poles)
+		{
+			for (auto i = 0; i < 3; ++i)
+			{
+				poles[i] = 1.0 / std::pow(BasePoles[i], 1.0 / q);
+			}
+		}
+
+		//The variance of the forward and the backward recursion together, E 2 p / (1 - p)^2
+		double recursionVariance(double q)
+		{
+			std::complex<double> poles[3];
+			scalePoles(q, poles);
+
+			auto variance = std::complex<double>(0.0);
+
+			for (auto pole : poles)
+			{
+				variance += 2.0 * pole / ((1.0 - pole) * (1.0 - pole));
+			}
+
+			return variance.real();
+		}
+
+		//w(n) = gain x(n) + feedback[0] w(n - 1) + feedback[1] w(n - 2) + feedback[2] w(n - 3)
+		struct RecursiveGaussian
+		{
+			explicit RecursiveGaussian(double sigma)
+			{
+				//The variance grows with q, q is bisected until the variance is sigma^2
+				auto low = 0.0;
+				auto high = sigma;
+
+				while (recursionVariance(high) < sigma * sigma)
+					high *= 2;
+
+				for (auto i = 0; i < 64; ++i)
+				{
+					auto q = (low + high) / 2;
+
+					if (recursionVariance(q) < sigma * sigma)
+						low = q;
+					else
+						high = q;
+				}
+
+				std::complex<double> p[3];
+				scalePoles((low + high) / 2, p);
+
+				//(1 - p0 z^-1)(1 - p1 z^-1)(1 - p2 z^-1) = 1 - a0 z^-1 - a1 z^-2 - a2 z^-3
+				auto a0 = (p[0] + p[1] + p[2]).real();
+				auto a1 = -(p[0] * p[1] + p[2] * (p[0] + p[1])).real();
+				auto a2 = (p[0] * p[1] * p[2]).real();
+
+				feedback[0] = static_cast<float>(a0);
+				feedback[1] = static_cast<float>(a1);
+				feedback[2] = static_cast<float>(a2);
+				gain = static_cast<float>(1 - a0 - a1 - a2);
+			}
+
+			float gain;
+			float feedback[3];
+		};
+
+		//Below this sigma the recursion is more than a grey level off the Gaussian at edges, the sampled kernel is short enough there
+		const double RecursiveSigma = 3.0;
+
+		//Separable correlation with the Gaussian sampled within 4 sigma, normalised to a sum of 1
+		cv::Mat sampledGaussian(const cv::Mat& f, double sigma, BorderMode border)
+		{
+			auto radius = static_cast<int>(std::ceil(4 * sigma));
+			std::vector<float> taps(2 * radius + 1);
+			auto sum = 0.0;
+
+			for (auto i = -radius; i <= radius; ++i)
+			{
+				taps[i + radius] = static_cast<float>(std::exp(-i * i / (2 * sigma * sigma)));
+				sum += taps[i + radius];
+			}
+
+			for (auto& tap : taps)
+			{
+				tap = static_cast<float>(tap / sum);
+			}
+
+			return correlateSeparable<uchar, float, uchar>(f, taps, taps, [](float result) {
+				return cv::saturate_cast<uchar>(result);
+			}, border);
+		}
+
+		//A single column, so the tails of the rows run the same recursion
+		struct ScalarFloat
+		{
+			typedef float Floats;
+			enum { FloatWidth = 1 };
+
+			static Floats loadFloats(const float* p) { return *p; }
+			static void storeFloats(float* p, Floats v) { *p = v; }
+			static Floats setFloats(float value) { return value; }
+			static Floats addFloats(Floats a, Floats b) { return a + b; }
+			static Floats multiplyFloats(Floats a, Floats b) { return a * b; }
+		};
+
+		//One step of the recursions of the columns x .. end - 1, previous[k] is the row k + 1 steps back
+		template <typename Isa>
+		void recurseColumns(const float* input, const float* const* previous, float* output, const RecursiveGaussian& recursion, int& x, int end)
+		{
+			auto gain = Isa::setFloats(recursion.gain);
+			auto feedback0 = Isa::setFloats(recursion.feedback[0]);
+			auto feedback1 = Isa::setFloats(recursion.feedback[1]);
+			auto feedback2 = Isa::setFloats(recursion.feedback[2]);
+
+			for (; x + Isa::FloatWidth <= end; x += Isa::FloatWidth)
+			{
+				auto value = Isa::multiplyFloats(gain, Isa::loadFloats(input + x));
+				value = Isa::addFloats(value, Isa::multiplyFloats(feedback0, Isa::loadFloats(previous[0] + x)));
+				value = Isa::addFloats(value, Isa::multiplyFloats(feedback1, Isa::loadFloats(previous[1] + x)));
+				value = Isa::addFloats(value, Isa::multiplyFloats(feedback2, Isa::loadFloats(previous[2] + x)));
+
+				Isa::storeFloats(output + x, value);
+			}
+		}
+
+		void recurseColumns(const float* input, const float* const* previous, float* output, const RecursiveGaussian& recursion, int begin, int end)
+		{
+			auto x = begin;
+
+#if DIP_AVX2
+			recurseColumns<Avx2>(input, previous, output, recursion, x, end);
+#endif
+#if DIP_SSE2
+			recurseColumns<Sse2>(input, previous, output, recursion, x, end);
+#endif
+			recurseColumns<ScalarFloat>(input, previous, output, recursion, x, end);
+		}
+
+		void smoothRows(const cv::Mat& f, cv::Mat& g, const RecursiveGaussian& recursion, int extension, BorderMode border)
+		{
+			auto length = f.cols + 2 * extension;
+
+			std::vector<int> columns(length);
+
+			for (auto i = 0; i < length; ++i)
+			{
+				columns[i] = borderIndex(i - extension, f.cols, border);
+			}
+
+			cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+				std::vector<float> line(length);
+				std::vector<float> forward(length);
+				std::vector<float> backward(length);
+
+				auto gain = recursion.gain;
+				auto feedback = recursion.feedback;
+
+				for (auto y = range.start; y < range.end; ++y)
+				{
+					auto row = f.ptr<uchar>(y);
+
+					for (auto i = 0; i < length; ++i)
+					{
+						line[i] = columns[i] < 0 ? 0.0f : row[columns[i]];
+					}
+
+					//The recursions start in the steady state of the first pixel
+					auto w1 = line[0], w2 = line[0], w3 = line[0];
+
+					for (auto i = 0; i < length; ++i)
+					{
+						forward[i] = gain * line[i] + feedback[0] * w1 + feedback[1] * w2 + feedback[2] * w3;
+						w3 = w2;
+						w2 = w1;
+						w1 = forward[i];
+					}
+
+					w1 = w2 = w3 = forward[length - 1];
+
+					for (auto i = length - 1; i >= 0; --i)
+					{
+						backward[i] = gain * forward[i] + feedback[0] * w1 + feedback[1] * w2 + feedback[2] * w3;
+						w3 = w2;
+						w2 = w1;
+						w1 = backward[i];
+					}
+
+					std::copy(backward.begin() + extension, backward.begin() + extension + f.cols, g.ptr<float>(y));
+				}
+			});
+		}
+
+		void smoothColumns(const cv::Mat& f, cv::Mat& g, const RecursiveGaussian& recursion, int extension, BorderMode border)
+		{
+			auto length = f.rows + 2 * extension;
+
+			std::vector<float> zeros(f.cols, 0.0f);
+			std::vector<const float*> lines(length);
+
+			for (auto i = 0; i < length; ++i)
+			{
+				auto row = borderIndex(i - extension, f.rows, border);
+				lines[i] = row < 0 ? zeros.data() : f.ptr<float>(row);
+			}
+
+			cv::Mat forward(length, f.cols, CV_32F);
+			cv::Mat backward(length, f.cols, CV_32F);
+
+			//The columns are independent, every stripe filters a range of them
+			cv::parallel_for_(cv::Range(0, f.cols), [&](const cv::Range& range) {
+				const float* previous[3];
+
+				previous[0] = previous[1] = previous[2] = lines[0];
+
+				for (auto i = 0; i < length; ++i)
+				{
+					auto output = forward.ptr<float>(i);
+
+					recurseColumns(lines[i], previous, output, recursion, range.start, range.end);
+
+					previous[2] = previous[1];
+					previous[1] = previous[0];
+					previous[0] = output;
+				}
+
+				previous[0] = previous[1] = previous[2] = forward.ptr<float>(length - 1);
+
+				for (auto i = length - 1; i >= 0; --i)
+				{
+					auto output = backward.ptr<float>(i);
+
+					recurseColumns(forward.ptr<float>(i), previous, output, recursion, range.start, range.end);
+
+					previous[2] = previous[1];
+					previous[1] = previous[0];
+					previous[0] = output;
+				}
+			});
+
+			backward.rowRange(extension, extension + f.rows).copyTo(g);
+		}
+	}
+
+	cv::Mat gaussianFilter(const cv::Mat& f, double sigma, BorderMode border)
+	{
+		CV_Assert(f.type() == CV_8U && sigma > 0);
+
+		if (sigma < RecursiveSigma)
+			return sampledGaussian(f, sigma, border);
+
+		RecursiveGaussian recursion(sigma);
+		auto extension = static_cast<int>(std::ceil(4 * sigma));
+
+		cv::Mat rows(f.rows, f.cols, CV_32F);
+		cv::Mat columns(f.rows, f.cols, CV_32F);
+		cv::Mat g;
+
+		smoothRows(f, rows, recursion, extension, border);
+		smoothColumns(rows, columns, recursion, extension, border);
+		columns.convertTo(g, CV_8U);
+
+		return g;
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef _GAUSSIAN_H
+#define _GAUSSIAN_H
+
+#include <opencv2/opencv.hpp>
+#include "border.h"
+
+namespace dip
+{
+/* Gaussian smoothing of an 8-bit image by a recursive filter, sigma > 0.
+* Every row and then every column is filtered by a third order recursion forward and another one backward(Young, van Vliet and van Ginkel),
+* together they approximate the Gaussian of sigma with the same number of operations per pixel for every sigma.
+* The poles of the recursion are scaled until its variance is sigma^2, it is within about 2 grey levels of the sampled Gaussian at edges of 255.
+* The error grows with the height of an edge, so it is largest along the border of the constant mode, where the image steps down to 0.
+* The lines are extended by 4 sigma pixels generated by the border mode, so the recursions settle before the image starts.
+* The column recursions run along the rows, FloatWidth adjacent columns at a time in SIMD lanes, in parallel stripes of columns.
+* Below sigma 3 the recursion is less accurate and f is correlated with the Gaussian sampled within 4 sigma in two 1D passes.
+*/
+cv::Mat gaussianFilter(const cv::Mat& f, double sigma, BorderMode border = BorderMode::Constant);
+}
+
+#endif
@@ -0,0 +1,390 @@
+#include "gradient.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "FixedKernel8u.h"
+
+namespace dip
+{
+	namespace
+	{
+		//The lane operations of the polar form on a single pixel, the tail of a row has the same arithmetic as the SIMD lanes
+		struct ScalarFloat
+		{
+			typedef float Floats;
+			typedef int Vector;
+
+			static Floats setFloats(float value) { return value; }
+			static Floats addFloats(Floats a, Floats b) { return a + b; }
+			static Floats subtractFloats(Floats a, Floats b) { return a - b; }
+			static Floats multiplyFloats(Floats a, Floats b) { return a * b; }
+			static Floats divideFloats(Floats a, Floats b) { return a / b; }
+			static Floats minFloats(Floats a, Floats b) { return a < b ? a : b; }
+			static Floats maxFloats(Floats a, Floats b) { return a > b ? a : b; }
+			static Floats absFloats(Floats v) { return std::abs(v); }
+			static Floats reciprocalSqrt(Floats v) { return 1 / std::sqrt(v); }
+			static bool greaterFloats(Floats a, Floats b) { return a > b; }
+			static Floats select(bool mask, Floats a, Floats b) { return mask ? a : b; }
+			static Floats toFloats(Vector v) { return static_cast<Floats>(v); }
+			static Vector round(Floats v) { return static_cast<Vector>(std::nearbyint(v)); }
+			static Vector truncate(Floats v) { return static_cast<Vector>(v); }
+		};
+
+		//Magnitude and sector of FloatWidth gradients
+		template <typename Isa>
+		void toPolar(typename Isa::Floats gx, typename Isa::Floats gy, float bins, typename Isa::Vector& magnitude, typename Isa::Vector& sector)
+		{
+			const auto pi = 3.14159265f;
+			auto set = [](float value) { return Isa::setFloats(value); };
+
+			//sqrt(s) = s / sqrt(s), the estimate r of 1 / sqrt(s) is refined by the Newton step r (1.5 - 0.5 s r^2)
+			//s = 0 takes the estimate of 1 and gives 0
+			auto squared = Isa::addFloats(Isa::multiplyFloats(gx, gx), Isa::multiplyFloats(gy, gy));
+			auto s = Isa::maxFloats(squared, set(1));
+			auto r = Isa::reciprocalSqrt(s);
+			auto halfSr2 = Isa::multiplyFloats(Isa::multiplyFloats(set(0.5f), s), Isa::multiplyFloats(r, r));
+			r = Isa::multiplyFloats(r, Isa::subtractFloats(set(1.5f), halfSr2));
+			magnitude = Isa::round(Isa::multiplyFloats(squared, r));
+
+			//tan^-1(z) ~ z (pi / 4 + 0.273 (1 - z)) for 0 <= z <= 1, z is the smaller of |gx| and |gy| over the larger one
+			auto ax = Isa::absFloats(gx);
+			auto ay = Isa::absFloats(gy);
+			auto z = Isa::divideFloats(Isa::minFloats(ax, ay), Isa::maxFloats(Isa::maxFloats(ax, ay), set(1)));
+			auto angle = Isa::multiplyFloats(z, Isa::addFloats(set(pi / 4), Isa::multiplyFloats(set(0.273f), Isa::subtractFloats(set(1), z))));
+
+			//The angle of the first octant is unfolded into 0..2 pi by the signs and the larger component
+			angle = Isa::select(Isa::greaterFloats(ay, ax), Isa::subtractFloats(set(pi / 2), angle), angle);
+			angle = Isa::select(Isa::greaterFloats(set(0), gx), Isa::subtractFloats(set(pi), angle), angle);
+			angle = Isa::select(Isa::greaterFloats(set(0), gy), Isa::subtractFloats(set(2 * pi), angle), angle);
+
+			//Rounded to the nearest sector centre, the last half sector wraps around to the sector 0
+			auto t = Isa::addFloats(Isa::multiplyFloats(angle, set(bins / (2 * pi))), set(0.5f));
+			t = Isa::select(Isa::greaterFloats(set(bins), t), t, Isa::subtractFloats(t, set(bins)));
+			sector = Isa::truncate(t);
+		}
+
+#if DIP_SSE2
+		//The responses of both of the Sobel kernels to Isa::Width pixels at a time, stored in the order of the pixels
+		template <typename Isa>
+		void sobelRow(const uchar* const* rows, short* gx, short* gy, int count, int& x)
+		{
+			for (; x + Isa::Width <= count; x += Isa::Width)
+			{
+				typename Isa::Vector low, high;
+
+				sumNeighbourhoods16s<SobelXKernel, Isa>(rows, x, low, high, std::make_index_sequence<9>());
+				Isa::store16(gx + x, low, high);
+				sumNeighbourhoods16s<SobelYKernel, Isa>(rows, x, low, high, std::make_index_sequence<9>());
+				Isa::store16(gy + x, low, high);
+			}
+		}
+
+		//Isa::Width pixels at a time, every half of them is a vector of 16-bit components which is widened into two vectors of floats
+		template <typename Isa>
+		void polarRow(const short* gx, const short* gy, ushort* magnitude, uchar* orientation, int count, float bins, int& x)
+		{
+			const auto half = Isa::Width / 2;
+
+			for (; x + Isa::Width <= count; x += Isa::Width)
+			{
+				typename Isa::Vector sectors[2];
+
+				for (auto h = 0; h < 2; ++h)
+				{
+					auto gxs = Isa::load16(gx + x + h * half);
+					auto gys = Isa::load16(gy + x + h * half);
+					typename Isa::Vector magnitudeLow, magnitudeHigh, sectorLow, sectorHigh;
+
+					toPolar<Isa>(Isa::toFloats(Isa::widenLow16(gxs)), Isa::toFloats(Isa::widenLow16(gys)), bins, magnitudeLow, sectorLow);
+					toPolar<Isa>(Isa::toFloats(Isa::widenHigh16(gxs)), Isa::toFloats(Isa::widenHigh16(gys)), bins, magnitudeHigh, sectorHigh);
+
+					//The magnitude of a Sobel gradient is below 1443, it fits into the signed lanes
+					Isa::store16(reinterpret_cast<short*>(magnitude + x + h * half), Isa::narrow32(magnitudeLow, magnitudeHigh));
+					sectors[h] = Isa::narrow32(sectorLow, sectorHigh);
+				}
+
+				Isa::store(orientation + x, Isa::narrowConsecutive(sectors[0], sectors[1]));
+			}
+		}
+#endif
+
+		void sobelResponses(const uchar* const* rows, short* gx, short* gy, int count)
+		{
+			auto x = 0;
+
+#if DIP_AVX2
+			sobelRow<Avx2>(rows, gx, gy, count, x);
+#endif
+#if DIP_SSE2
+			sobelRow<Sse2>(rows, gx, gy, count, x);
+#endif
+
+			for (; x < count; ++x)
+			{
+				gx[x] = static_cast<short>(applyFixedKernel<SobelXKernel, int>(rows, x, std::make_index_sequence<9>()));
+				gy[x] = static_cast<short>(applyFixedKernel<SobelYKernel, int>(rows, x, std::make_index_sequence<9>()));
+			}
+		}
+
+		//The polar form of sobelGradient of count gradients
+		void polarGradient(const short* gx, const short* gy, ushort* magnitude, uchar* orientation, int count, int bins)
+		{
+			auto x = 0;
+			auto sectors = static_cast<float>(bins);
+
+#if DIP_AVX2
+			polarRow<Avx2>(gx, gy, magnitude, orientation, count, sectors, x);
+#endif
+#if DIP_SSE2
+			polarRow<Sse2>(gx, gy, magnitude, orientation, count, sectors, x);
+#endif
+
+			for (; x < count; ++x)
+			{
+				int length, sector;
+
+				toPolar<ScalarFloat>(static_cast<float>(gx[x]), static_cast<float>(gy[x]), sectors, length, sector);
+				magnitude[x] = static_cast<ushort>(length);
+				orientation[x] = static_cast<uchar>(sector);
+			}
+		}
+
+		//The Sobel responses of any row of f, every band of a parallel filter has its own because of the strip of the border columns
+		class SobelRows
+		{
+		public:
+			SobelRows(const cv::Mat& f, BorderMode border)
+				: f_(f), border_(border), constantRow_(f.cols, 0)
+			{
+			}
+
+			void operator()(int y, short* gx, short* gy)
+			{
+				const uchar* source[3];
+
+				for (auto t = 0; t < 3; ++t)
+				{
+					auto row = borderIndex(y + t - 1, f_.rows, border_);
+					source[t] = row < 0 ? constantRow_.data() : f_.ptr<uchar>(row);
+				}
+
+				filterColumns(source, 3, f_.cols, 3, border_, strip_, [&](const uchar* const* rows, int begin, int count) {
+					sobelResponses(rows, gx + begin, gy + begin, count);
+				});
+			}
+
+		private:
+			const cv::Mat& f_;
+			BorderMode border_;
+			std::vector<uchar> constantRow_;
+			std::vector<uchar> strip_;
+		};
+
+		//Labels of the pixels of Canny, a candidate is an edge once it is connected to an edge
+		const uchar NotEdge = 0;
+		const uchar Candidate = 1;
+		const uchar Edge = 255;
+
+		/* Labels the rows begin .. end - 1 of g by non-maximum suppression and the thresholds, the edges are pushed into edges.
+		* The gradient is computed a row ahead into a ring of three rows, the rows above and below the band are computed
+		* again by the neighbouring bands instead of being shared. The magnitudes outside f are 0.
+		*/
+		void suppressNonMaxima(const cv::Mat& f, cv::Mat& g, int begin, int end, int low, int high, BorderMode border, std::vector<cv::Point>& edges)
+		{
+			const auto cols = f.cols;
+			const auto stride = cols + 2;
+
+			SobelRows sobel(f, border);
+			std::vector<short> gx(cols);
+			std::vector<short> gy(cols);
+			//A column of 0 at both ends of the magnitude rows, so the neighbours of the first and the last columns are read as inside
+			std::vector<ushort> magnitudes(3 * stride, 0);
+			std::vector<uchar> sectors(3 * cols);
+
+			auto magnitudeRow = [&](int y) { return magnitudes.data() + (y + 3) % 3 * stride + 1; };
+			auto sectorRow = [&](int y) { return sectors.data() + (y + 3) % 3 * cols; };
+
+			auto compute = [&](int y) {
+				if (y < 0 || y >= f.rows)
+				{
+					std::fill(magnitudeRow(y), magnitudeRow(y) + cols, ushort(0));
+					return;
+				}
+
+				sobel(y, gx.data(), gy.data());
+				polarGradient(gx.data(), gy.data(), magnitudeRow(y), sectorRow(y), cols, 8);
+			};
+
+			compute(begin - 1);
+			compute(begin);
+
+			for (auto y = begin; y < end; ++y)
+			{
+				compute(y + 1);
+
+				auto above = magnitudeRow(y - 1);
+				auto centre = magnitudeRow(y);
+				auto below = magnitudeRow(y + 1);
+				auto sector = sectorRow(y);
+				auto output = g.ptr<uchar>(y);
+
+				for (auto x = 0; x < cols; ++x)
+				{
+					int m = centre[x];
+
+					if (m <= low)
+					{
+						output[x] = NotEdge;
+						continue;
+					}
+
+					//The neighbours along the gradient, x runs down the rows so the sector 0 is vertical and the sector 2 is horizontal
+					int first, second;
+
+					switch (sector[x] & 3)
+					{
+					case 0: first = above[x]; second = below[x]; break;
+					case 1: first = above[x - 1]; second = below[x + 1]; break;
+					case 2: first = centre[x - 1]; second = centre[x + 1]; break;
+					default: first = above[x + 1]; second = below[x - 1]; break;
+					}
+
+					//A plateau across the gradient keeps a single pixel
+					if (m > first && m >= second)
+					{
+						output[x] = m > high ? Edge : Candidate;
+
+						if (m > high)
+							edges.push_back(cv::Point(x, y));
+					}
+					else
+					{
+						output[x] = NotEdge;
+					}
+				}
+			}
+		}
+
+		//Turns the candidates which are 8-connected to the edges into edges within the rows begin .. end - 1
+		void trace(cv::Mat& g, int begin, int end, std::vector<cv::Point>& edges)
+		{
+			while (!edges.empty())
+			{
+				auto p = edges.back();
+				edges.pop_back();
+
+				for (auto y = std::max(p.y - 1, begin); y <= std::min(p.y + 1, end - 1); ++y)
+				{
+					auto row = g.ptr<uchar>(y);
+
+					for (auto x = std::max(p.x - 1, 0); x <= std::min(p.x + 1, g.cols - 1); ++x)
+					{
+						if (row[x] == Candidate)
+						{
+							row[x] = Edge;
+							edges.push_back(cv::Point(x, y));
+						}
+					}
+				}
+			}
+		}
+
+		//Turns the candidates of the row to which are next to an edge of the row from into edges, the rows are the two sides of a seam
+		void crossSeam(cv::Mat& g, int from, int to, std::vector<cv::Point>& edges)
+		{
+			auto source = g.ptr<uchar>(from);
+			auto target = g.ptr<uchar>(to);
+
+			for (auto x = 0; x < g.cols; ++x)
+			{
+				if (source[x] != Edge)
+					continue;
+
+				for (auto s = std::max(x - 1, 0); s <= std::min(x + 1, g.cols - 1); ++s)
+				{
+					if (target[s] == Candidate)
+					{
+						target[s] = Edge;
+						edges.push_back(cv::Point(s, to));
+					}
+				}
+			}
+		}
+	}
+
+	void sobelGradient(const cv::Mat& f, cv::Mat& magnitude, cv::Mat& orientation, int bins, BorderMode border)
+	{
+		CV_Assert(f.type() == CV_8U && bins >= 1 && bins <= 256);
+
+		magnitude.create(f.rows, f.cols, CV_16U);
+		orientation.create(f.rows, f.cols, CV_8U);
+
+		cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+			SobelRows sobel(f, border);
+			//The responses of a row stay in the cache until they are turned into the polar form
+			std::vector<short> gx(f.cols);
+			std::vector<short> gy(f.cols);
+
+			for (auto y = range.start; y < range.end; ++y)
+			{
+				sobel(y, gx.data(), gy.data());
+				polarGradient(gx.data(), gy.data(), magnitude.ptr<ushort>(y), orientation.ptr<uchar>(y), f.cols, bins);
+			}
+		}, std::max(1, std::min(cv::getNumThreads(), f.rows / 8)));
+	}
+
+	cv::Mat canny(const cv::Mat& f, double lowThreshold, double highThreshold, BorderMode border)
+	{
+		CV_Assert(f.type() == CV_8U && lowThreshold <= highThreshold);
+
+		cv::Mat g(f.rows, f.cols, CV_8U);
+
+		//The magnitudes are integers, m > threshold is m > floor(threshold)
+		auto low = static_cast<int>(std::floor(lowThreshold));
+		auto high = static_cast<int>(std::floor(highThreshold));
+
+		//A band should be many rows high, two more rows of the gradient are computed for every band
+		auto bands = std::max(1, std::min(cv::getNumThreads(), f.rows / 32));
+		auto bandBegin = [&](int band) { return band * f.rows / bands; };
+
+		cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+			std::vector<cv::Point> edges;
+
+			for (auto band = range.start; band < range.end; ++band)
+			{
+				suppressNonMaxima(f, g, bandBegin(band), bandBegin(band + 1), low, high, border, edges);
+				trace(g, bandBegin(band), bandBegin(band + 1), edges);
+			}
+		});
+
+		/* A candidate which is still not an edge but is connected to an edge is connected through a pair of pixels across a seam,
+		* the edge on one side and the candidate on the other, since the path inside of a band was traced by the band.
+		* The candidates at the seams are the seeds of a last trace over the whole image, it only visits the pixels which become edges.
+		*/
+		std::vector<cv::Point> edges;
+
+		for (auto band = 1; band < bands; ++band)
+		{
+			auto seam = bandBegin(band);
+
+			crossSeam(g, seam - 1, seam, edges);
+			crossSeam(g, seam, seam - 1, edges);
+		}
+
+		trace(g, 0, f.rows, edges);
+
+		cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+			for (auto y = range.start; y < range.end; ++y)
+			{
+				auto row = g.ptr<uchar>(y);
+
+				for (auto x = 0; x < f.cols; ++x)
+				{
+					row[x] = row[x] == Edge ? Edge : NotEdge;
+				}
+			}
+		});
+
+		return g;
+	}
+}
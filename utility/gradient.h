@@ -0,0 +1,29 @@
+#ifndef _GRADIENT_H
+#define _GRADIENT_H
+
+#include <opencv2/opencv.hpp>
+#include "border.h"
+
+namespace dip
+{
+/* Sobel gradient of an 8-bit image in polar form, Equations 10.2-10 and 10.2-11, in a single pass.
+* gx and gy are the correlations with SobelXKernel and SobelYKernel, x runs down the rows as in the book.
+* magnitude is the L2 norm sqrt(gx^2 + gy^2) rounded into CV_16U. orientation is the direction tan^-1(gy / gx) in 0..360 degrees
+* quantised into bins(1..256) sectors of CV_8U, the sector b is centred at b * 360 / bins degrees, e.g. the 8 sectors of Canny.
+* The gradient of a flat neighbourhood is in the sector 0.
+* The square root and the arc tangent are approximated in SIMD lanes, the magnitude by a reciprocal square root estimate
+* refined by a Newton step and the direction by a quadratic within 0.25 degrees, no pixel calls sqrt or atan2.
+*/
+void sobelGradient(const cv::Mat& f, cv::Mat& magnitude, cv::Mat& orientation, int bins = 8, BorderMode border = BorderMode::Constant);
+
+/* Canny edges of an 8-bit image as 255 on 0, Section 10.2.6 without the smoothing, e.g. f is smoothed by gaussianFilter first.
+* The pixels whose L2 magnitude(see sobelGradient) is a maximum along the gradient direction are edges above highThreshold
+* and candidates above lowThreshold, a candidate is an edge when it is 8-connected to an edge through candidates.
+* The image is split into bands of rows filtered in parallel. A band computes the gradient a row ahead into a ring of three rows and
+* suppresses the non-maxima from them, so no image of magnitudes or directions is stored, then traces the candidates from its edges.
+* Only the paths which cross the seams between the bands are traced again, from the pixels on both sides of the seams.
+*/
+cv::Mat canny(const cv::Mat& f, double lowThreshold, double highThreshold, BorderMode border = BorderMode::Constant);
+}
+
+#endif
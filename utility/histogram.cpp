@@ -0,0 +1,19 @@
+#include "histogram.h"
+#include "utility.h"
+
+namespace dip
+{
+	cv::Mat drawHistogram(const std::vector<double>& pdf)
+	{
+		auto range = 256;
+		auto binsPerColumn = std::max<int>(1, pdf.size() / range);
+		std::vector<double> columns(range, 0);
+
+		for (auto i = 0u; i < pdf.size(); ++i)
+		{
+			columns[std::min<int>(range - 1, i / binsPerColumn)] += pdf[i];
+		}
+
+		return drawHistogram(columns.data(), range);
+	}
+}
@@ -0,0 +1,134 @@
+#include "matching.h"
+#include <algorithm>
+#include <cmath>
+
+namespace dip
+{
+	namespace
+	{
+		//Below every score in [-1, 1], so a placement scoring -1 is still found
+		const double Suppressed = -2;
+
+		//Best placements of a score map which are at least the size of the template apart, at least one when count > 0
+		std::vector<TemplateMatch> bestPlacements(cv::Mat scores, cv::Size templateSize, int count)
+		{
+			std::vector<TemplateMatch> placements;
+			scores = scores.clone();
+
+			for (auto i = 0; i < count; ++i)
+			{
+				auto maxScore = .0;
+				cv::Point maxLocation;
+
+				cv::minMaxLoc(scores, nullptr, &maxScore, nullptr, &maxLocation);
+
+				if (maxScore <= Suppressed)
+					break;
+
+				placements.push_back({ maxLocation, maxScore });
+
+				//Suppress the placements which overlap the chosen one by more than half of the template
+				auto suppressed = cv::Rect(maxLocation.x - templateSize.width / 2, maxLocation.y - templateSize.height / 2,
+					templateSize.width, templateSize.height) & cv::Rect(0, 0, scores.cols, scores.rows);
+
+				scores(suppressed).setTo(cv::Scalar(Suppressed));
+			}
+
+			return placements;
+		}
+	}
+
+	cv::Mat matchTemplateNcc(const cv::Mat& f, const cv::Mat& t, CorrelationMethod method)
+	{
+		CV_Assert(f.type() == CV_8U && t.type() == CV_8U && t.rows <= f.rows && t.cols <= f.cols);
+
+		auto n = static_cast<double>(t.rows * t.cols);
+		auto templateMean = cv::mean(t)[0];
+
+		cv::Mat zeroMeanTemplate;
+		t.convertTo(zeroMeanTemplate, CV_64F, 1, -templateMean);
+
+		auto templateEnergy = 0.0;
+
+		for (auto y = 0; y < zeroMeanTemplate.rows; ++y)
+		{
+			auto row = zeroMeanTemplate.ptr<double>(y);
+
+			for (auto x = 0; x < zeroMeanTemplate.cols; ++x)
+			{
+				templateEnergy += row[x] * row[x];
+			}
+		}
+
+		//E f(x + s, y + t) (w(s, t) - wm), the same sized output of correlate is anchored at the centre of the template
+		auto correlated = correlate<uchar, double, double>(f, zeroMeanTemplate, [](double result) { return result; }, method);
+		auto a = (t.cols - 1) / 2;
+		auto b = (t.rows - 1) / 2;
+
+		cv::Mat sum, squareSum;
+		cv::integral(f, sum, squareSum, CV_64F, CV_64F);
+
+		cv::Mat g(f.rows - t.rows + 1, f.cols - t.cols + 1, CV_64F);
+
+		for (auto y = 0; y < g.rows; ++y)
+		{
+			auto numerator = correlated.ptr<double>(y + b) + a;
+			auto sumTop = sum.ptr<double>(y);
+			auto sumBottom = sum.ptr<double>(y + t.rows);
+			auto squareTop = squareSum.ptr<double>(y);
+			auto squareBottom = squareSum.ptr<double>(y + t.rows);
+			auto output = g.ptr<double>(y);
+
+			for (auto x = 0; x < g.cols; ++x)
+			{
+				auto windowSum = sumBottom[x + t.cols] - sumBottom[x] - sumTop[x + t.cols] + sumTop[x];
+				auto windowSquareSum = squareBottom[x + t.cols] - squareBottom[x] - squareTop[x + t.cols] + squareTop[x];
+				//E (f - fxy)^2 = E f^2 - (E f)^2 / n
+				auto windowEnergy = std::max(0.0, windowSquareSum - windowSum * windowSum / n);
+				auto denominator = std::sqrt(windowEnergy * templateEnergy);
+
+				output[x] = denominator > 1e-9 ? std::min(1.0, std::max(-1.0, numerator[x] / denominator)) : 0.0;
+			}
+		}
+
+		return g;
+	}
+
+	TemplateMatch matchTemplateCoarseToFine(const cv::Mat& f, const cv::Mat& t, int levels, int candidates, CorrelationMethod method)
+	{
+		while (levels > 0 && std::min(t.rows, t.cols) >> levels < 4)
+			--levels;
+
+		if (levels <= 0)
+			return bestPlacements(matchTemplateNcc(f, t, method), t.size(), 1).front();
+
+		auto scale = 1 << levels;
+		cv::Mat coarseImage, coarseTemplate;
+
+		cv::resize(f, coarseImage, cv::Size(f.cols / scale, f.rows / scale), 0, 0, cv::INTER_AREA);
+		cv::resize(t, coarseTemplate, cv::Size(t.cols / scale, t.rows / scale), 0, 0, cv::INTER_AREA);
+
+		auto coarseScores = matchTemplateNcc(coarseImage, coarseTemplate, method);
+		auto coarse = bestPlacements(coarseScores, coarseTemplate.size(), std::max(1, candidates));
+
+		TemplateMatch best = { cv::Point(0, 0), -2 };
+		auto placements = cv::Rect(0, 0, f.cols - t.cols + 1, f.rows - t.rows + 1);
+
+		for (const auto& candidate : coarse)
+		{
+			//The placements within a coarse pixel around the scaled up candidate
+			auto window = cv::Rect(candidate.location.x * scale - scale, candidate.location.y * scale - scale, 3 * scale, 3 * scale) & placements;
+
+			if (window.area() == 0)
+				continue;
+
+			auto region = f(cv::Rect(window.x, window.y, window.width + t.cols - 1, window.height + t.rows - 1));
+			auto refined = bestPlacements(matchTemplateNcc(region, t, method), t.size(), 1).front();
+
+			if (refined.score > best.score)
+				best = { refined.location + window.tl(), refined.score };
+		}
+
+		return best;
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef _MATCHING_H
+#define _MATCHING_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "convolution.h"
+
+namespace dip
+{
+struct TemplateMatch
+{
+	//Top left corner of the template on the image
+	cv::Point location;
+	double score;
+};
+
+/* Zero mean normalised cross-correlation of an 8-bit template t at every placement on an 8-bit image f
+*                        E (f(x + s, y + t) - fxy) (w(s, t) - wm)
+* g(x, y) = --------------------------------------------------------------------
+*           sqrt( E (f(x + s, y + t) - fxy)^2  E (w(s, t) - wm)^2 )
+* fxy is the mean of f under the template and wm is the mean of the template, g is in [-1, 1] so it doesn't
+* change with the brightness and the contrast of f. The result has (f.cols - t.cols + 1) x (f.rows - t.rows + 1) CV_64F
+* scores, the flat placements score 0.
+* The numerator is the correlation of f with the zero mean template, which is correlate() in the spatial or the
+* frequency domain(see CorrelationMethod). The sums and the sums of squares under the template come from integral
+* images, so the denominator costs O(1) per placement.
+*/
+cv::Mat matchTemplateNcc(const cv::Mat& f, const cv::Mat& t, CorrelationMethod method = CorrelationMethod::Automatic);
+
+/* Coarse to fine search of the best placement of t on f.
+* Both are downscaled by 2^levels and matched, the best candidates of the coarse level(at least a template apart)
+* are refined on the full resolution image within 2^levels pixels of their scaled up locations.
+* levels is reduced while the downscaled template would be smaller than 4 pixels, levels = 0 is a full search.
+*/
+TemplateMatch matchTemplateCoarseToFine(const cv::Mat& f, const cv::Mat& t, int levels, int candidates, CorrelationMethod method = CorrelationMethod::Automatic);
+}
+
+#endif
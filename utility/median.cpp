@@ -0,0 +1,376 @@
+#include "median.h"
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include "simd.h"
+
+namespace dip
+{
+	namespace
+	{
+		const auto coarseBins = 16;
+		const auto fineBins = 256;
+		//Fine bins of a coarse bin
+		const auto binWidth = fineBins / coarseBins;
+
+		//Histograms of the columns of a stripe and of the neighbourhood which is slid over them
+		class MedianHistograms
+		{
+		public:
+			MedianHistograms(int cols, int size)
+				: fine_(cols * fineBins, 0),
+				  coarse_(cols * coarseBins, 0),
+				  constantFine_(fineBins, 0),
+				  constantCoarse_(coarseBins, 0)
+			{
+				//The columns outside a constant border are zeros
+				constantFine_[0] = static_cast<std::uint16_t>(size);
+				constantCoarse_[0] = static_cast<std::uint16_t>(size);
+			}
+
+			void add(const uchar* row, int cols)
+			{
+				for (auto x = 0; x < cols; ++x)
+				{
+					++fine_[x * fineBins + row[x]];
+					++coarse_[x * coarseBins + (row[x] >> 4)];
+				}
+			}
+
+			void slide(const uchar* leaving, const uchar* entering, int cols)
+			{
+				for (auto x = 0; x < cols; ++x)
+				{
+					--fine_[x * fineBins + leaving[x]];
+					--coarse_[x * coarseBins + (leaving[x] >> 4)];
+					++fine_[x * fineBins + entering[x]];
+					++coarse_[x * coarseBins + (entering[x] >> 4)];
+				}
+			}
+
+			//Histograms of a column of f, -1 stands for the constant
+			const std::uint16_t* fine(int column) const
+			{
+				return column < 0 ? constantFine_.data() : fine_.data() + column * fineBins;
+			}
+
+			const std::uint16_t* coarse(int column) const
+			{
+				return column < 0 ? constantCoarse_.data() : coarse_.data() + column * coarseBins;
+			}
+
+		private:
+			std::vector<std::uint16_t> fine_;
+			std::vector<std::uint16_t> coarse_;
+			std::vector<std::uint16_t> constantFine_;
+			std::vector<std::uint16_t> constantCoarse_;
+		};
+
+		//The smaller of the values at Low and High goes to Low, the larger one to High
+		template <int Low, int High>
+		struct Compare
+		{
+			template <typename Isa>
+			static void apply(typename Isa::Vector* values)
+			{
+				auto low = Isa::min8(values[Low], values[High]);
+				values[High] = Isa::max8(values[Low], values[High]);
+				values[Low] = low;
+			}
+		};
+
+		template <typename Isa, typename... Comparators>
+		void applyNetwork(typename Isa::Vector* values, std::tuple<Comparators...>)
+		{
+			int expand[] = { 0, (Comparators::template apply<Isa>(values), 0)... };
+			(void)expand;
+		}
+
+		//A single pixel, so the tails of the rows run the same networks
+		struct Scalar8u
+		{
+			typedef uchar Vector;
+			enum { Width = 1 };
+
+			static Vector load(const uchar* p) { return *p; }
+			static void store(uchar* p, Vector v) { *p = v; }
+			static Vector min8(Vector a, Vector b) { return std::min(a, b); }
+			static Vector max8(Vector a, Vector b) { return std::max(a, b); }
+		};
+
+		/* Sorting networks of the median of a Size x Size neighbourhood.
+		* Column sorts a column of the neighbourhood, the sorted columns are shared by the Size outputs which read them.
+		* Neighbourhood takes the sorted columns, the rank r of the column j at j * Size + r, and leaves the median at Median.
+		* It sorts the ranks across the columns, after which the values at the lower left(upper right) corner are known
+		* to be below(above) the median, and takes the median of the rest. The comparators whose outputs don't reach
+		* the median are left out, the networks are checked for every 0-1 input.
+		*/
+		template <int Size>
+		struct MedianNetwork;
+
+		template <>
+		struct MedianNetwork<3>
+		{
+			typedef std::tuple<Compare<0, 1>, Compare<0, 2>, Compare<1, 2>> Column;
+			typedef std::tuple<Compare<0, 3>, Compare<0, 6>, Compare<3, 6>, Compare<1, 4>, Compare<1, 7>, Compare<4, 7>,
+				Compare<2, 5>, Compare<2, 8>, Compare<6, 4>, Compare<6, 2>, Compare<4, 2>> Neighbourhood;
+			enum { Median = 4 };
+		};
+
+		template <>
+		struct MedianNetwork<5>
+		{
+			typedef std::tuple<Compare<0, 1>, Compare<2, 3>, Compare<0, 2>, Compare<1, 3>, Compare<1, 2>, Compare<0, 4>,
+				Compare<2, 4>, Compare<1, 2>, Compare<3, 4>> Column;
+			typedef std::tuple<Compare<0, 5>, Compare<10, 15>, Compare<0, 10>, Compare<5, 15>, Compare<5, 10>, Compare<0, 20>,
+				Compare<10, 20>, Compare<15, 20>, Compare<1, 6>, Compare<11, 16>, Compare<1, 11>, Compare<6, 16>,
+				Compare<6, 11>, Compare<1, 21>, Compare<11, 21>, Compare<6, 11>, Compare<16, 21>, Compare<2, 7>,
+				Compare<12, 17>, Compare<2, 12>, Compare<7, 17>, Compare<7, 12>, Compare<2, 22>, Compare<12, 22>,
+				Compare<7, 12>, Compare<17, 22>, Compare<3, 8>, Compare<13, 18>, Compare<3, 13>, Compare<8, 18>,
+				Compare<8, 13>, Compare<3, 23>, Compare<13, 23>, Compare<8, 13>, Compare<4, 9>, Compare<14, 19>,
+				Compare<4, 14>, Compare<9, 19>, Compare<9, 14>, Compare<4, 24>, Compare<14, 24>, Compare<9, 14>,
+				Compare<15, 20>, Compare<11, 16>, Compare<15, 11>, Compare<20, 16>, Compare<20, 11>, Compare<21, 7>,
+				Compare<12, 17>, Compare<21, 12>, Compare<7, 17>, Compare<7, 12>, Compare<15, 21>, Compare<11, 12>,
+				Compare<11, 21>, Compare<20, 7>, Compare<16, 17>, Compare<16, 7>, Compare<20, 11>, Compare<16, 21>,
+				Compare<7, 12>, Compare<3, 8>, Compare<13, 4>, Compare<3, 13>, Compare<8, 4>, Compare<8, 13>,
+				Compare<3, 9>, Compare<13, 9>, Compare<8, 13>, Compare<4, 9>, Compare<15, 3>, Compare<21, 9>,
+				Compare<21, 3>, Compare<11, 13>, Compare<12, 13>, Compare<12, 3>, Compare<20, 8>, Compare<7, 8>,
+				Compare<16, 4>, Compare<16, 7>, Compare<7, 12>> Neighbourhood;
+			enum { Median = 12 };
+		};
+
+		//Sorts Isa::Width columns at a time starting from i, the rank r of the column i goes to sorted[r][i]
+		template <int Size, typename Isa>
+		void sortColumns(const uchar* const* rows, uchar* const* sorted, int count, int& i)
+		{
+			for (; i + Isa::Width <= count; i += Isa::Width)
+			{
+				typename Isa::Vector values[Size];
+
+				for (auto t = 0; t < Size; ++t)
+				{
+					values[t] = Isa::load(rows[t] + i);
+				}
+
+				applyNetwork<Isa>(values, typename MedianNetwork<Size>::Column());
+
+				for (auto r = 0; r < Size; ++r)
+				{
+					Isa::store(sorted[r] + i, values[r]);
+				}
+			}
+		}
+
+		//Medians of Isa::Width pixels at a time starting from x, the neighbourhood of x reads the sorted columns x .. x + Size - 1
+		template <int Size, typename Isa>
+		void mergeColumns(const uchar* const* sorted, uchar* output, int count, int& x)
+		{
+			for (; x + Isa::Width <= count; x += Isa::Width)
+			{
+				typename Isa::Vector values[Size * Size];
+
+				for (auto j = 0; j < Size; ++j)
+				{
+					for (auto r = 0; r < Size; ++r)
+					{
+						values[j * Size + r] = Isa::load(sorted[r] + x + j);
+					}
+				}
+
+				applyNetwork<Isa>(values, typename MedianNetwork<Size>::Neighbourhood());
+
+				Isa::store(output + x, values[MedianNetwork<Size>::Median]);
+			}
+		}
+
+		template <int Size>
+		cv::Mat networkMedianFilter(const cv::Mat& f, BorderMode border)
+		{
+			cv::Mat g(f.rows, f.cols, CV_8U);
+			//The sorted columns of a row, the neighbourhoods reach Size - 1 columns past the outputs
+			auto width = f.cols + Size - 1;
+			std::vector<uchar> columns(Size * width);
+			uchar* sorted[Size];
+
+			for (auto r = 0; r < Size; ++r)
+			{
+				sorted[r] = columns.data() + r * width;
+			}
+
+			filterRows<uchar, uchar>(f, g, Size, Size, border, [&](const uchar* const* rows, uchar* output, int count) {
+				auto i = 0;
+				auto x = 0;
+
+#if DIP_AVX2
+				sortColumns<Size, Avx2>(rows, sorted, count + Size - 1, i);
+#endif
+#if DIP_SSE2
+				sortColumns<Size, Sse2>(rows, sorted, count + Size - 1, i);
+#endif
+				sortColumns<Size, Scalar8u>(rows, sorted, count + Size - 1, i);
+
+#if DIP_AVX2
+				mergeColumns<Size, Avx2>(sorted, output, count, x);
+#endif
+#if DIP_SSE2
+				mergeColumns<Size, Sse2>(sorted, output, count, x);
+#endif
+				mergeColumns<Size, Scalar8u>(sorted, output, count, x);
+			});
+
+			return g;
+		}
+
+		//The value at the index rank of every sorted neighbourhood, the first value whose cumulative count exceeds the rank
+		cv::Mat histogramRankFilter(const cv::Mat& f, int size, int rank, BorderMode border)
+		{
+			auto a = (size - 1) / 2;
+			//Columns of the neighbourhoods, the column i is the column i - a of f
+			auto width = f.cols + size - 1;
+
+			std::vector<int> columns(width);
+			std::vector<uchar> zeros(f.cols, 0);
+
+			for (auto i = 0; i < width; ++i)
+			{
+				columns[i] = borderIndex(i - a, f.cols, border);
+			}
+
+			auto sourceRow = [&](int y) {
+				auto row = borderIndex(y, f.rows, border);
+				return row < 0 ? zeros.data() : f.ptr<uchar>(row);
+			};
+
+			cv::Mat g(f.rows, f.cols, CV_8U);
+
+			//A stripe should be a few neighbourhoods high, otherwise the column histograms of its first row dominate
+			auto stripes = std::max(1, std::min(cv::getNumThreads(), f.rows / (2 * size)));
+
+			cv::parallel_for_(cv::Range(0, f.rows), [&](const cv::Range& range) {
+				MedianHistograms histograms(f.cols, size);
+				int coarse[coarseBins];
+				int fine[fineBins];
+				//The position at which the fine bins of a coarse bin were brought up to date
+				int updated[coarseBins];
+
+				for (auto t = 0; t < size; ++t)
+				{
+					histograms.add(sourceRow(range.start + t - a), f.cols);
+				}
+
+				for (auto y = range.start; y < range.end; ++y)
+				{
+					auto output = g.ptr<uchar>(y);
+
+					std::fill(coarse, coarse + coarseBins, 0);
+					std::fill(updated, updated + coarseBins, -size);
+
+					for (auto s = 0; s < size; ++s)
+					{
+						auto column = histograms.coarse(columns[s]);
+
+						for (auto k = 0; k < coarseBins; ++k)
+						{
+							coarse[k] += column[k];
+						}
+					}
+
+					for (auto x = 0; x < f.cols; ++x)
+					{
+						if (x > 0)
+						{
+							auto entering = histograms.coarse(columns[x + size - 1]);
+							auto leaving = histograms.coarse(columns[x - 1]);
+
+							for (auto k = 0; k < coarseBins; ++k)
+							{
+								coarse[k] += entering[k] - leaving[k];
+							}
+						}
+
+						auto count = 0;
+						auto bin = 0;
+
+						while (count + coarse[bin] <= rank)
+						{
+							count += coarse[bin++];
+						}
+
+						auto bins = fine + bin * binWidth;
+						auto offset = bin * binWidth;
+
+						//The fine bins are summed again when the neighbourhood has moved past all of their columns
+						if (x - updated[bin] >= size)
+						{
+							std::fill(bins, bins + binWidth, 0);
+
+							for (auto s = x; s < x + size; ++s)
+							{
+								auto column = histograms.fine(columns[s]) + offset;
+
+								for (auto k = 0; k < binWidth; ++k)
+								{
+									bins[k] += column[k];
+								}
+							}
+						}
+						else
+						{
+							for (auto s = updated[bin] + 1; s <= x; ++s)
+							{
+								auto entering = histograms.fine(columns[s + size - 1]) + offset;
+								auto leaving = histograms.fine(columns[s - 1]) + offset;
+
+								for (auto k = 0; k < binWidth; ++k)
+								{
+									bins[k] += entering[k] - leaving[k];
+								}
+							}
+						}
+
+						updated[bin] = x;
+
+						auto k = 0;
+
+						while (count + bins[k] <= rank)
+						{
+							count += bins[k++];
+						}
+
+						output[x] = static_cast<uchar>(offset + k);
+					}
+
+					//Slide the column histograms down by one row
+					if (y + 1 < range.end)
+						histograms.slide(sourceRow(y - a), sourceRow(y + size - a), f.cols);
+				}
+			}, stripes);
+
+			return g;
+		}
+	}
+
+	cv::Mat medianFilter(const cv::Mat& f, int size, BorderMode border)
+	{
+		CV_Assert(f.type() == CV_8U && size > 0 && size * size < 65536);
+
+		//The small neighbourhoods are cheaper to sort by a network in SIMD lanes than to count
+		if (size == 3)
+			return networkMedianFilter<3>(f, border);
+
+		if (size == 5)
+			return networkMedianFilter<5>(f, border);
+
+		return histogramRankFilter(f, size, size * size / 2, border);
+	}
+
+	cv::Mat percentileFilter(const cv::Mat& f, int size, double percentile, BorderMode border)
+	{
+		CV_Assert(f.type() == CV_8U && size > 0 && size * size < 65536 && percentile >= 0 && percentile <= 100);
+
+		auto rank = cvRound(percentile / 100 * (size * size - 1));
+
+		return histogramRankFilter(f, size, rank, border);
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef _MEDIAN_H
+#define _MEDIAN_H
+
+#include <opencv2/opencv.hpp>
+#include "border.h"
+
+namespace dip
+{
+/* Median filter of a size x size neighbourhood on an 8-bit image, the output is the value at the index size * size / 2
+* of the sorted neighbourhood.
+* The neighbourhoods are not sorted, a histogram of the size pixels of every column is kept and slid down by one row
+* and the histogram of the neighbourhood is slid along the row over them(Perreault and Hebert).
+* The histograms have 16 coarse bins of the high 4 bits over 256 fine bins, the coarse bins are slid at every pixel and
+* locate the median, the fine bins of a coarse bin are brought up to date only when the median falls into it.
+* So a pixel costs about the same for every size. The rows are filtered in parallel stripes.
+* The 3x3 and 5x5 neighbourhoods are sorted by min/max networks instead, 16(SSE2) or 32(AVX2) pixels at a time.
+* Every column is sorted once and shared by the neighbourhoods which read it.
+*/
+cv::Mat medianFilter(const cv::Mat& f, int size, BorderMode border = BorderMode::Constant);
+
+/* The percentile of every size x size neighbourhood, the value at the index round(percentile / 100 * (size * size - 1))
+* of the sorted neighbourhood, counted in the same sliding histograms as the median. 0 is the minimum, 100 is the maximum.
+* A low percentile of a large neighbourhood is a background estimate which ignores the bright objects on it.
+*/
+cv::Mat percentileFilter(const cv::Mat& f, int size, double percentile, BorderMode border = BorderMode::Constant);
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef _SIMD_H
+#define _SIMD_H
+
+/* Instruction sets the hand vectorized filters are compiled for.
+* SSE2 is part of every x86-64 target, AVX2 is enabled by the DIP_ENABLE_AVX2 CMake option(-mavx2).
+* Every vectorized filter has a scalar path, so the other targets compile without them.
+*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DIP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define DIP_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace dip
+{
+/* The operations of an instruction set the filters are written with, so a filter is written once and
+* instantiated for every instruction set. Width is the number of 8-bit lanes, the 16-bit operations work on half as many.
+* Floats holds FloatWidth 32-bit floats.
+*/
+#if DIP_SSE2
+struct Sse2
+{
+	typedef __m128i Vector;
+	enum { Width = 16 };
+
+	static Vector load(const unsigned char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static void store(unsigned char* p, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+	static Vector zero() { return _mm_setzero_si128(); }
+	static Vector set16(short value) { return _mm_set1_epi16(value); }
+
+	//Zero extends the low and the high half of the 8-bit lanes to 16 bits
+	static Vector widenLow(Vector v) { return _mm_unpacklo_epi8(v, zero()); }
+	static Vector widenHigh(Vector v) { return _mm_unpackhi_epi8(v, zero()); }
+	//Inverse of widenLow and widenHigh, saturates to 0..255
+	static Vector narrow(Vector low, Vector high) { return _mm_packus_epi16(low, high); }
+
+	static Vector min8(Vector a, Vector b) { return _mm_min_epu8(a, b); }
+	static Vector max8(Vector a, Vector b) { return _mm_max_epu8(a, b); }
+
+	static Vector addSaturate16(Vector a, Vector b) { return _mm_adds_epu16(a, b); }
+	static Vector add16(Vector a, Vector b) { return _mm_add_epi16(a, b); }
+	static Vector subtract16(Vector a, Vector b) { return _mm_sub_epi16(a, b); }
+	//Signed maximum
+	static Vector max16(Vector a, Vector b) { return _mm_max_epi16(a, b); }
+	static Vector multiply16(Vector a, Vector b) { return _mm_mullo_epi16(a, b); }
+	static Vector multiplyHigh16(Vector a, Vector b) { return _mm_mulhi_epu16(a, b); }
+	template <int Shift>
+	static Vector shiftRight16(Vector v) { return _mm_srli_epi16(v, Shift); }
+	//Stores the 16-bit lanes of widenLow and widenHigh in the order of their 8-bit pixels
+	static void store16(short* p, Vector low, Vector high)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), low);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p + 8), high);
+	}
+
+	typedef __m128 Floats;
+	enum { FloatWidth = 4 };
+
+	static Floats loadFloats(const float* p) { return _mm_loadu_ps(p); }
+	static void storeFloats(float* p, Floats v) { _mm_storeu_ps(p, v); }
+	static Floats setFloats(float value) { return _mm_set1_ps(value); }
+	static Floats addFloats(Floats a, Floats b) { return _mm_add_ps(a, b); }
+	static Floats multiplyFloats(Floats a, Floats b) { return _mm_mul_ps(a, b); }
+	static Floats subtractFloats(Floats a, Floats b) { return _mm_sub_ps(a, b); }
+	static Floats divideFloats(Floats a, Floats b) { return _mm_div_ps(a, b); }
+	static Floats minFloats(Floats a, Floats b) { return _mm_min_ps(a, b); }
+	static Floats maxFloats(Floats a, Floats b) { return _mm_max_ps(a, b); }
+	static Floats absFloats(Floats v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+	//About 12 bits of 1 / sqrt(v)
+	static Floats reciprocalSqrt(Floats v) { return _mm_rsqrt_ps(v); }
+	//All ones in the lanes where a > b, select takes a lane of a where the mask is set and of b elsewhere
+	static Floats greaterFloats(Floats a, Floats b) { return _mm_cmpgt_ps(a, b); }
+	static Floats select(Floats mask, Floats a, Floats b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	//The 16-bit lanes sign extended to 32 bits and narrowed back with saturation, narrow32(widenLow16(v), widenHigh16(v)) is v
+	static Vector load16(const short* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static void store16(short* p, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+	static Vector widenLow16(Vector v) { return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); }
+	static Vector widenHigh16(Vector v) { return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+	static Vector narrow32(Vector low, Vector high) { return _mm_packs_epi32(low, high); }
+	//Narrows the 16-bit lanes of two consecutive loads into 8-bit lanes in the same order, saturates to 0..255
+	static Vector narrowConsecutive(Vector first, Vector second) { return _mm_packus_epi16(first, second); }
+
+	//Rounded to the nearest and truncated 32-bit integers
+	static Floats toFloats(Vector v) { return _mm_cvtepi32_ps(v); }
+	static Vector round(Floats v) { return _mm_cvtps_epi32(v); }
+	static Vector truncate(Floats v) { return _mm_cvttps_epi32(v); }
+};
+#endif
+
+#if DIP_AVX2
+struct Avx2
+{
+	typedef __m256i Vector;
+	enum { Width = 32 };
+
+	static Vector load(const unsigned char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static void store(unsigned char* p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+	static Vector zero() { return _mm256_setzero_si256(); }
+	static Vector set16(short value) { return _mm256_set1_epi16(value); }
+
+	//The unpacks and the pack work within 128-bit lanes, narrow(widenLow(v), widenHigh(v)) is still v
+	static Vector widenLow(Vector v) { return _mm256_unpacklo_epi8(v, zero()); }
+	static Vector widenHigh(Vector v) { return _mm256_unpackhi_epi8(v, zero()); }
+	static Vector narrow(Vector low, Vector high) { return _mm256_packus_epi16(low, high); }
+
+	static Vector min8(Vector a, Vector b) { return _mm256_min_epu8(a, b); }
+	static Vector max8(Vector a, Vector b) { return _mm256_max_epu8(a, b); }
+
+	static Vector addSaturate16(Vector a, Vector b) { return _mm256_adds_epu16(a, b); }
+	static Vector add16(Vector a, Vector b) { return _mm256_add_epi16(a, b); }
+	static Vector subtract16(Vector a, Vector b) { return _mm256_sub_epi16(a, b); }
+	static Vector max16(Vector a, Vector b) { return _mm256_max_epi16(a, b); }
+	static Vector multiply16(Vector a, Vector b) { return _mm256_mullo_epi16(a, b); }
+	static Vector multiplyHigh16(Vector a, Vector b) { return _mm256_mulhi_epu16(a, b); }
+	template <int Shift>
+	static Vector shiftRight16(Vector v) { return _mm256_srli_epi16(v, Shift); }
+	//widenLow holds the pixels 0..7 and 16..23, widenHigh 8..15 and 24..31
+	static void store16(short* p, Vector low, Vector high)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_permute2x128_si256(low, high, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p + 16), _mm256_permute2x128_si256(low, high, 0x31));
+	}
+
+	typedef __m256 Floats;
+	enum { FloatWidth = 8 };
+
+	static Floats loadFloats(const float* p) { return _mm256_loadu_ps(p); }
+	static void storeFloats(float* p, Floats v) { _mm256_storeu_ps(p, v); }
+	static Floats setFloats(float value) { return _mm256_set1_ps(value); }
+	static Floats addFloats(Floats a, Floats b) { return _mm256_add_ps(a, b); }
+	static Floats multiplyFloats(Floats a, Floats b) { return _mm256_mul_ps(a, b); }
+	static Floats subtractFloats(Floats a, Floats b) { return _mm256_sub_ps(a, b); }
+	static Floats divideFloats(Floats a, Floats b) { return _mm256_div_ps(a, b); }
+	static Floats minFloats(Floats a, Floats b) { return _mm256_min_ps(a, b); }
+	static Floats maxFloats(Floats a, Floats b) { return _mm256_max_ps(a, b); }
+	static Floats absFloats(Floats v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v); }
+	static Floats reciprocalSqrt(Floats v) { return _mm256_rsqrt_ps(v); }
+	static Floats greaterFloats(Floats a, Floats b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static Floats select(Floats mask, Floats a, Floats b) { return _mm256_blendv_ps(b, a, mask); }
+
+	//The unpacks and the packs work within 128-bit lanes, narrow32(widenLow16(v), widenHigh16(v)) is still v
+	static Vector load16(const short* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static void store16(short* p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+	static Vector widenLow16(Vector v) { return _mm256_srai_epi32(_mm256_unpacklo_epi16(v, v), 16); }
+	static Vector widenHigh16(Vector v) { return _mm256_srai_epi32(_mm256_unpackhi_epi16(v, v), 16); }
+	static Vector narrow32(Vector low, Vector high) { return _mm256_packs_epi32(low, high); }
+	static Vector narrowConsecutive(Vector first, Vector second) { return _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8); }
+
+	static Floats toFloats(Vector v) { return _mm256_cvtepi32_ps(v); }
+	static Vector round(Floats v) { return _mm256_cvtps_epi32(v); }
+	static Vector truncate(Floats v) { return _mm256_cvttps_epi32(v); }
+};
+#endif
+}
+
+#endif
@@ -2,7 +2,7 @@
 
 namespace dip
 {
-	cv::Mat drawHistogram(double* pdf, int range)
+	cv::Mat drawHistogram(const double* pdf, int range)
 	{
 		cv::Mat histogram = cv::Mat(range, range, CV_8UC3 , cv::Scalar(255 , 255 , 255));
 
@@ -47,7 +47,7 @@ T stayInBoundaries(T val, NamedType<U , UpperBoundaryParameter> upper, NamedType
 	return val;
 }
 
-cv::Mat drawHistogram(double* values,  int range);
+cv::Mat drawHistogram(const double* values,  int range);
 
 }
 